@@ -0,0 +1,231 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+#include "Small_Range_Coalescer.h"
+
+
+using namespace cfeyer::ip_coalesce;
+
+
+// Table lines' worth of ranges, range_count per line, clustered closely
+// enough that some of each line's ranges coalesce.
+static std::vector<std::vector<IP_Range>> make_lines( std::size_t range_count )
+{
+   static constexpr std::size_t line_count = 1024;
+
+   std::mt19937 rng( 42 );
+   std::uniform_int_distribution<uint32_t> base( 0, 0xffff0000 );
+   std::uniform_int_distribution<uint32_t> offset( 0, 64 * range_count );
+   std::uniform_int_distribution<uint32_t> length( 0, 63 );
+
+   std::vector<std::vector<IP_Range>> lines( line_count );
+
+   for( std::vector<IP_Range> & line : lines )
+   {
+      uint32_t line_base = base( rng );
+      for( std::size_t i = 0; i < range_count; i++ )
+      {
+         uint32_t start = line_base + offset( rng );
+         line.push_back( IP_Range::from_start_and_end_addresses( start, start + length( rng ) ) );
+      }
+   }
+
+   return lines;
+}
+
+
+static void set_line_counters( benchmark::State & state, const std::vector<std::vector<IP_Range>> & lines )
+{
+   state.SetItemsProcessed( state.iterations() * lines.size() * state.range( 0 ) );
+   state.counters["lines"] = benchmark::Counter( state.iterations() * lines.size(), benchmark::Counter::kIsRate );
+}
+
+
+// The std::set-based path each table line used to take.
+static void BM_coalescing_set_build( benchmark::State & state )
+{
+   const std::vector<std::vector<IP_Range>> lines = make_lines( state.range( 0 ) );
+
+   for( auto _ : state )
+   {
+      for( const std::vector<IP_Range> & line : lines )
+      {
+         Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::vector<IP_Range>( line ) );
+         benchmark::DoNotOptimize( set.size() );
+      }
+   }
+
+   set_line_counters( state, lines );
+}
+BENCHMARK(BM_coalescing_set_build)->Arg(1)->Arg(4)->Arg(16)->Arg(256);
+
+
+// A reused vector through sort_and_coalesce().
+static void BM_sort_and_coalesce( benchmark::State & state )
+{
+   const std::vector<std::vector<IP_Range>> lines = make_lines( state.range( 0 ) );
+   std::vector<IP_Range> ranges;
+
+   for( auto _ : state )
+   {
+      for( const std::vector<IP_Range> & line : lines )
+      {
+         ranges.assign( line.begin(), line.end() );
+         sort_and_coalesce( ranges );
+         ranges.erase( std::unique( ranges.begin(), ranges.end() ), ranges.end() );
+         benchmark::DoNotOptimize( ranges.data() );
+      }
+   }
+
+   set_line_counters( state, lines );
+}
+BENCHMARK(BM_sort_and_coalesce)->Arg(1)->Arg(4)->Arg(16)->Arg(256);
+
+
+// Small_Range_Coalescer, falling back to the above when a line is over its
+// capacity, as ip-coalesce-table does.
+static void BM_small_range_coalescer( benchmark::State & state )
+{
+   const std::vector<std::vector<IP_Range>> lines = make_lines( state.range( 0 ) );
+   Small_Range_Coalescer coalescer;
+   std::vector<IP_Range> ranges;
+
+   for( auto _ : state )
+   {
+      for( const std::vector<IP_Range> & line : lines )
+      {
+         if( line.size() <= Small_Range_Coalescer::capacity )
+         {
+            coalescer.clear();
+            for( const IP_Range & range : line )
+            {
+               coalescer.push_back( range );
+            }
+            coalescer.coalesce();
+            benchmark::DoNotOptimize( coalescer.begin() );
+         }
+         else
+         {
+            ranges.assign( line.begin(), line.end() );
+            sort_and_coalesce( ranges );
+            ranges.erase( std::unique( ranges.begin(), ranges.end() ), ranges.end() );
+            benchmark::DoNotOptimize( ranges.data() );
+         }
+      }
+   }
+
+   set_line_counters( state, lines );
+}
+BENCHMARK(BM_small_range_coalescer)->Arg(1)->Arg(4)->Arg(16)->Arg(256);
+
+
+enum Insert_Order
+{
+   sorted_order,
+   reverse_sorted_order,
+   random_order,
+   adversarial_order
+};
+
+// Disjoint /28s with one-block gaps, in the given order.  The adversarial
+// order follows the blocks with every other gap, each of which merges the
+// ranges on both sides, and then one range spanning them all, which merges
+// everything left.
+static std::vector<IP_Range> make_insert_ranges( Insert_Order order )
+{
+   static constexpr uint32_t block_count = 1 << 16;
+   static constexpr uint32_t block_size = 16;
+
+   std::vector<IP_Range> ranges;
+
+   for( uint32_t i = 0; i < block_count; i++ )
+   {
+      uint32_t start = 0x0a000000 + (i * 2 * block_size);
+      ranges.push_back( IP_Range::from_start_and_end_addresses( start, start + block_size - 1 ) );
+   }
+
+   switch( order )
+   {
+      case sorted_order:
+         break;
+
+      case reverse_sorted_order:
+         std::reverse( ranges.begin(), ranges.end() );
+         break;
+
+      case random_order:
+         std::shuffle( ranges.begin(), ranges.end(), std::mt19937( 42 ) );
+         break;
+
+      case adversarial_order:
+      {
+         for( uint32_t i = 0; i < block_count; i += 2 )
+         {
+            uint32_t gap_start = ranges[i].get_end_address() + 1;
+            ranges.push_back( IP_Range::from_start_and_end_addresses( gap_start, gap_start + block_size - 1 ) );
+         }
+
+         ranges.push_back( IP_Range::from_start_and_end_addresses( 0x0a000000, 0x0a000000 + (block_count * 2 * block_size) ) );
+         break;
+      }
+   }
+
+   return ranges;
+}
+
+
+static void BM_coalescing_set_insert( benchmark::State & state )
+{
+   const std::vector<IP_Range> ranges = make_insert_ranges( static_cast<Insert_Order>(state.range( 0 )) );
+
+   for( auto _ : state )
+   {
+      Coalescing_IP_Range_Set set;
+
+      for( const IP_Range & range : ranges )
+      {
+         set.insert( range );
+      }
+
+      benchmark::DoNotOptimize( set.size() );
+   }
+
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_coalescing_set_insert)
+   ->ArgName( "order" )
+   ->Arg( sorted_order )
+   ->Arg( reverse_sorted_order )
+   ->Arg( random_order )
+   ->Arg( adversarial_order )
+   ->Unit( benchmark::kMillisecond );
@@ -0,0 +1,190 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "benchmark/benchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char ** environ;
+
+
+// End-to-end runs of the command-line tools in ../bin, next to this
+// executable, over inputs made once by ip-coalesce-generate into a temporary
+// directory.  Each iteration times one whole process, from spawn to exit.
+
+namespace {
+
+std::string bin_dir()
+{
+   char path[4096];
+   ssize_t length = readlink( "/proc/self/exe", path, sizeof(path) - 1 );
+   if( length <= 0 ) return "../bin";
+
+   std::string exe_path( path, length );
+   return exe_path.substr( 0, exe_path.rfind( '/' ) ) + "/../bin";
+}
+
+
+// Runs args[0] from bin_dir() with standard input from input_path and
+// standard output to output_path.  Returns false unless it exits with status 0.
+bool run_tool( const std::vector<std::string> & args, const std::string & input_path,
+               const std::string & output_path = "/dev/null" )
+{
+   const std::string tool_path = bin_dir() + "/" + args[0];
+
+   std::vector<char *> argv;
+   argv.push_back( const_cast<char *>(tool_path.c_str()) );
+   for( std::size_t i = 1; i < args.size(); i++ )
+   {
+      argv.push_back( const_cast<char *>(args[i].c_str()) );
+   }
+   argv.push_back( nullptr );
+
+   posix_spawn_file_actions_t file_actions;
+   posix_spawn_file_actions_init( &file_actions );
+   posix_spawn_file_actions_addopen( &file_actions, STDIN_FILENO, input_path.c_str(), O_RDONLY, 0 );
+   posix_spawn_file_actions_addopen( &file_actions, STDOUT_FILENO, output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+   pid_t pid;
+   int error = posix_spawn( &pid, tool_path.c_str(), &file_actions, nullptr, argv.data(), environ );
+   posix_spawn_file_actions_destroy( &file_actions );
+
+   if( error != 0 ) return false;
+
+   int status = 0;
+   if( waitpid( pid, &status, 0 ) != pid ) return false;
+
+   return WIFEXITED( status ) && (WEXITSTATUS( status ) == 0);
+}
+
+
+class Input_Files
+{
+   public:
+
+      Input_Files()
+      {
+         const char * tmpdir = std::getenv( "TMPDIR" );
+         std::string dir_template = std::string( tmpdir ? tmpdir : "/tmp" ) + "/ip_coalesce_bench_XXXXXX";
+
+         if( !mkdtemp( &dir_template[0] ) ) std::abort();
+         m_dir = dir_template;
+
+         m_ranges_path = m_dir + "/ranges.txt";
+         m_table_path = m_dir + "/table.txt";
+
+         if( !run_tool( { "ip-coalesce-generate", "--seed", "42", "--count", "1048576" }, "/dev/null", m_ranges_path ) ||
+             !run_tool( { "ip-coalesce-generate", "--seed", "42", "--count", "131072", "--table", "--ranges-per-line", "32" },
+                        "/dev/null", m_table_path ) )
+         {
+            std::abort();
+         }
+      }
+
+      ~Input_Files()
+      {
+         std::remove( m_ranges_path.c_str() );
+         std::remove( m_table_path.c_str() );
+         rmdir( m_dir.c_str() );
+      }
+
+      const std::string & ranges_path() const { return m_ranges_path; }
+      const std::string & table_path() const { return m_table_path; }
+
+   private:
+
+      std::string m_dir;
+      std::string m_ranges_path;
+      std::string m_table_path;
+};
+
+
+const Input_Files & input_files()
+{
+   static const Input_Files files;
+   return files;
+}
+
+
+void run_tool_benchmark( benchmark::State & state, const std::vector<std::string> & args, const std::string & input_path )
+{
+   for( auto _ : state )
+   {
+      auto start = std::chrono::steady_clock::now();
+      bool is_success = run_tool( args, input_path );
+      auto stop = std::chrono::steady_clock::now();
+
+      if( !is_success )
+      {
+         state.SkipWithError( ("Failed to run " + args[0]).c_str() );
+         break;
+      }
+
+      state.SetIterationTime( std::chrono::duration<double>( stop - start ).count() );
+   }
+}
+
+} // namespace
+
+
+static void BM_ip_coalesce( benchmark::State & state )
+{
+   static const std::vector<std::string> modes[] = {
+      { "ip-coalesce" },
+      { "ip-coalesce", "--cidr-only" },
+      { "ip-coalesce", "--max-memory", "4M" },
+   };
+
+   const Input_Files & files = input_files();
+   run_tool_benchmark( state, modes[state.range( 0 )], files.ranges_path() );
+}
+BENCHMARK(BM_ip_coalesce)
+   ->ArgName( "mode" )
+   ->DenseRange( 0, 2 )
+   ->UseManualTime()
+   ->Unit( benchmark::kMillisecond );
+
+
+static void BM_ip_coalesce_table( benchmark::State & state )
+{
+   static const std::vector<std::string> modes[] = {
+      { "ip-coalesce-table" },
+      { "ip-coalesce-table", "--cidr-only" },
+   };
+
+   const Input_Files & files = input_files();
+   run_tool_benchmark( state, modes[state.range( 0 )], files.table_path() );
+}
+BENCHMARK(BM_ip_coalesce_table)
+   ->ArgName( "mode" )
+   ->DenseRange( 0, 1 )
+   ->UseManualTime()
+   ->Unit( benchmark::kMillisecond );
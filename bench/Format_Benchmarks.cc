@@ -0,0 +1,128 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+
+using namespace cfeyer::ip_coalesce;
+
+
+// Single addresses, CIDR blocks, start-end ranges and non-contiguous netmasks,
+// so each formatting branch is taken.
+static const std::vector<IP_Range> & format_ranges()
+{
+   static const std::vector<IP_Range> ranges = [] {
+      std::mt19937 rng( 42 );
+      std::uniform_int_distribution<uint32_t> address( 0, 0xfffffff0 );
+      std::uniform_int_distribution<int> prefix_length( 8, 32 );
+      std::uniform_int_distribution<int> kind( 0, 3 );
+
+      std::vector<IP_Range> result;
+
+      for( int i = 0; i < (1 << 18); i++ )
+      {
+         uint32_t start = address( rng );
+
+         switch( kind( rng ) )
+         {
+            case 0: result.push_back( IP_Range::from_start_and_end_addresses( start, start ) ); break;
+            case 1: result.push_back( IP_Range( start, ~0u << (32 - prefix_length( rng )) ) ); break;
+            case 2: result.push_back( IP_Range::from_start_and_end_addresses( start, start + 9 ) ); break;
+            case 3: result.push_back( IP_Range( start, 0xff00ff00 ) ); break;
+         }
+      }
+
+      return result;
+   }();
+
+   return ranges;
+}
+
+
+static void BM_to_string( benchmark::State & state )
+{
+   const std::vector<IP_Range> & ranges = format_ranges();
+
+   for( auto _ : state )
+   {
+      for( const IP_Range & range : ranges )
+      {
+         std::string str = range.to_string();
+         benchmark::DoNotOptimize( str.data() );
+      }
+   }
+
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_to_string)->Unit(benchmark::kMillisecond);
+
+
+static void BM_stream_output( benchmark::State & state )
+{
+   const std::vector<IP_Range> & ranges = format_ranges();
+
+   for( auto _ : state )
+   {
+      std::ostringstream strm;
+
+      for( const IP_Range & range : ranges )
+      {
+         strm << range << ' ';
+      }
+
+      benchmark::DoNotOptimize( strm.str().size() );
+   }
+
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_stream_output)->Unit(benchmark::kMillisecond);
+
+
+static void BM_format_range( benchmark::State & state )
+{
+   const std::vector<IP_Range> & ranges = format_ranges();
+   std::vector<char> buffer( ranges.size() * (IP_Range::max_string_length + 1) );
+
+   for( auto _ : state )
+   {
+      char * out = buffer.data();
+
+      for( const IP_Range & range : ranges )
+      {
+         out = format_range( out, range );
+         *out++ = ' ';
+      }
+
+      benchmark::DoNotOptimize( out );
+   }
+
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_format_range)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,149 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "benchmark/benchmark.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+#include <cfeyer/ip_coalesce/DIR_24_8_Table.h>
+
+
+using namespace cfeyer::ip_coalesce;
+
+
+// Blocklist-like set: CIDRs from /12 to /32 scattered over the address space.
+static const Coalescing_IP_Range_Set & lookup_set()
+{
+   static const Coalescing_IP_Range_Set set = []()
+   {
+      std::mt19937 rng( 42 );
+      std::uniform_int_distribution<uint32_t> address;
+      std::uniform_int_distribution<int> prefix_length( 12, 32 );
+
+      std::vector<IP_Range> ranges;
+      for( int i = 0; i < 100000; i++ )
+      {
+         int length = prefix_length( rng );
+         uint32_t mask = 0xffffffffu << (32 - length);
+         ranges.push_back( IP_Range( address( rng ) & mask, mask ) );
+      }
+
+      return Coalescing_IP_Range_Set::build( std::move(ranges) );
+   }();
+
+   return set;
+}
+
+
+struct Timed_Table
+{
+   DIR_24_8_Table table;
+   double build_ms;
+};
+
+static const Timed_Table & lookup_table()
+{
+   static const Timed_Table timed_table = []()
+   {
+      const Coalescing_IP_Range_Set & set = lookup_set();
+
+      auto start = std::chrono::steady_clock::now();
+      DIR_24_8_Table table = DIR_24_8_Table::build( set );
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+      return Timed_Table{ std::move(table), elapsed.count() };
+   }();
+
+   return timed_table;
+}
+
+
+// Uniformly random addresses, or with skew set, nine in ten lookups drawn
+// from a few thousand hot addresses, as with repeat connections.
+static std::vector<uint32_t> make_addresses( bool skewed )
+{
+   std::mt19937 rng( 7 );
+   std::uniform_int_distribution<uint32_t> address;
+   std::uniform_int_distribution<int> percent( 0, 99 );
+
+   std::vector<uint32_t> hot_addresses( 4096 );
+   for( uint32_t & hot_address : hot_addresses ) hot_address = address( rng );
+   std::uniform_int_distribution<std::size_t> hot_index( 0, hot_addresses.size() - 1 );
+
+   std::vector<uint32_t> addresses( 1 << 20 );
+   for( uint32_t & a : addresses )
+   {
+      a = (skewed && (percent( rng ) < 90)) ? hot_addresses[hot_index( rng )] : address( rng );
+   }
+
+   return addresses;
+}
+
+
+template< typename Lookup >
+static void run_lookups( benchmark::State & state, Lookup lookup )
+{
+   const std::vector<uint32_t> addresses = make_addresses( state.range( 0 ) != 0 );
+   std::size_t hits = 0;
+
+   for( auto _ : state )
+   {
+      for( uint32_t address : addresses )
+      {
+         hits += lookup( address );
+      }
+      benchmark::DoNotOptimize( hits );
+   }
+
+   state.SetItemsProcessed( state.iterations() * addresses.size() );
+   state.SetLabel( state.range( 0 ) ? "skewed" : "random" );
+}
+
+
+static void BM_dir_24_8_lookup( benchmark::State & state )
+{
+   const Timed_Table & timed_table = lookup_table();
+
+   run_lookups( state, [&]( uint32_t address ) { return timed_table.table.contains( address ); } );
+
+   state.counters["build_ms"] = timed_table.build_ms;
+   state.counters["memory_MiB"] = timed_table.table.memory_bytes() / double( 1 << 20 );
+   state.counters["chunks"] = timed_table.table.chunk_count();
+}
+BENCHMARK(BM_dir_24_8_lookup)->Arg(0)->Arg(1);
+
+
+static void BM_set_contains( benchmark::State & state )
+{
+   const Coalescing_IP_Range_Set & set = lookup_set();
+
+   run_lookups( state, [&]( uint32_t address ) { return set.contains( address ); } );
+
+   state.counters["ranges"] = set.size();
+}
+BENCHMARK(BM_set_contains)->Arg(0)->Arg(1);
@@ -0,0 +1,151 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+
+using namespace cfeyer::ip_coalesce;
+
+
+// Newline-separated addresses, CIDRs, netmasks and dash ranges in roughly the
+// proportions seen in blocklist feeds.
+static std::string make_range_text( std::size_t line_count )
+{
+   std::mt19937 rng( 42 );
+   std::uniform_int_distribution<uint32_t> octet( 0, 255 );
+   std::uniform_int_distribution<uint32_t> prefix_length( 8, 32 );
+   std::uniform_int_distribution<int> syntax( 0, 9 );
+
+   std::ostringstream strm;
+
+   for( std::size_t i = 0; i < line_count; i++ )
+   {
+      strm << octet(rng) << '.' << octet(rng) << '.' << octet(rng) << '.' << octet(rng);
+
+      int kind = syntax( rng );
+      if( kind < 4 )
+      {
+         strm << '/' << prefix_length( rng );
+      }
+      else if( kind == 4 )
+      {
+         strm << "/255.255.255.0";
+      }
+      else if( kind == 5 )
+      {
+         strm << "-255.255.255.255";
+      }
+
+      strm << '\n';
+   }
+
+   return strm.str();
+}
+
+
+static const std::string & range_text()
+{
+   static const std::string text = make_range_text( 1 << 20 );
+   return text;
+}
+
+
+static void BM_parse_ranges( benchmark::State & state )
+{
+   const std::string & text = range_text();
+   std::vector<IP_Range> ranges;
+
+   for( auto _ : state )
+   {
+      ranges.clear();
+      parse_ranges( text, ranges );
+      benchmark::DoNotOptimize( ranges.data() );
+   }
+
+   state.SetBytesProcessed( state.iterations() * text.size() );
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_parse_ranges)->Unit(benchmark::kMillisecond);
+
+
+static void BM_from_string_per_token( benchmark::State & state )
+{
+   const std::string & text = range_text();
+   std::vector<IP_Range> ranges;
+
+   for( auto _ : state )
+   {
+      ranges.clear();
+
+      std::size_t begin = 0;
+      while( begin < text.size() )
+      {
+         std::size_t end = text.find( '\n', begin );
+         IP_Range range;
+         range.from_string( std::string_view( text ).substr( begin, end - begin ) );
+         ranges.push_back( range );
+         begin = end + 1;
+      }
+
+      benchmark::DoNotOptimize( ranges.data() );
+   }
+
+   state.SetBytesProcessed( state.iterations() * text.size() );
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_from_string_per_token)->Unit(benchmark::kMillisecond);
+
+
+static void BM_stream_input( benchmark::State & state )
+{
+   const std::string & text = range_text();
+   std::vector<IP_Range> ranges;
+
+   for( auto _ : state )
+   {
+      ranges.clear();
+
+      std::istringstream strm( text );
+      IP_Range range;
+      while( strm >> range )
+      {
+         ranges.push_back( range );
+      }
+
+      benchmark::DoNotOptimize( ranges.data() );
+   }
+
+   state.SetBytesProcessed( state.iterations() * text.size() );
+   state.SetItemsProcessed( state.iterations() * ranges.size() );
+}
+BENCHMARK(BM_stream_input)->Unit(benchmark::kMillisecond);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#!/bin/bash
+#
+# Compares two Google Benchmark JSON result files benchmark by benchmark.
+#
+# SYNOPSIS:
+#
+#   compare_to_baseline.sh BASELINE.json RESULTS.json [THRESHOLD_PERCENT]
+#
+# Prints each benchmark's real time in both files and the change, and exits
+# with status 1 if any benchmark got slower by more than THRESHOLD_PERCENT
+# (default 10).
+
+if [ $# -lt 2 ]; then
+   echo "Usage: $0 BASELINE.json RESULTS.json [THRESHOLD_PERCENT]" >&2
+   exit 2
+fi
+
+BASELINE="$1"
+RESULTS="$2"
+THRESHOLD="${3:-10}"
+
+for FILE in "${BASELINE}" "${RESULTS}"; do
+   if [ ! -f "${FILE}" ]; then
+      echo "$0: ${FILE} not found" >&2
+      exit 2
+   fi
+done
+
+# Prints "name real_time_ns" for each benchmark of a result file.  The JSON
+# writer puts each field on its own line, with time_unit after real_time.
+extract_times() {
+   awk '
+      /"name":/      { name = $0; sub( /^[^:]*: *"/, "", name ); sub( /",? *$/, "", name ) }
+      /"real_time":/ { time = $2; sub( /,$/, "", time ) }
+      /"time_unit":/ {
+         unit = $2; gsub( /[",]/, "", unit )
+         scale = (unit == "s") ? 1e9 : (unit == "ms") ? 1e6 : (unit == "us") ? 1e3 : 1
+         printf "%s %.6g\n", name, time * scale
+      }
+   ' "$1"
+}
+
+awk -v threshold="${THRESHOLD}" '
+   NR == FNR { baseline[$1] = $2; next }
+   {
+      seen[$1] = 1
+
+      if( !($1 in baseline) )
+      {
+         printf "%-60s %14s %14.0f %9s\n", $1, "-", $2, "new"
+         next
+      }
+
+      change = (baseline[$1] > 0) ? 100 * ($2 - baseline[$1]) / baseline[$1] : 0
+      flag = ""
+      if( change > threshold )
+      {
+         flag = "  REGRESSION"
+         regressions++
+      }
+      printf "%-60s %14.0f %14.0f %+8.1f%%%s\n", $1, baseline[$1], $2, change, flag
+   }
+   BEGIN { printf "%-60s %14s %14s %9s\n", "Benchmark", "Baseline ns", "Current ns", "Change" }
+   END {
+      for( name in baseline )
+      {
+         if( !(name in seen) ) printf "%-60s %14.0f %14s %9s\n", name, baseline[name], "-", "missing"
+      }
+
+      if( regressions > 0 )
+      {
+         printf "%d benchmark(s) more than %s%% slower than the baseline\n", regressions, threshold
+         exit 1
+      }
+   }
+' <(extract_times "${BASELINE}") <(extract_times "${RESULTS}")
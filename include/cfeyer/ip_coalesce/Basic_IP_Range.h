@@ -0,0 +1,261 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef BASIC_IP_RANGE_H
+#define BASIC_IP_RANGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Width-generic address math.  Address is an unsigned integer type of 32, 64
+// or 128 bits; everything is constexpr so each family's code is specialized
+// at compile time.
+
+template< typename Address >
+constexpr int address_bits = sizeof(Address) * 8;
+
+
+// Undefined for zero, as the builtins are.
+template< typename Address >
+constexpr int count_leading_zeros( Address x )
+{
+   if constexpr( sizeof(Address) <= sizeof(uint64_t) )
+   {
+      return __builtin_clzll( x ) - (64 - address_bits<Address>);
+   }
+   else
+   {
+      uint64_t high = static_cast<uint64_t>(x >> 64);
+      return high ? __builtin_clzll( high ) : 64 + __builtin_clzll( static_cast<uint64_t>(x) );
+   }
+}
+
+
+// Undefined for zero, as the builtins are.
+template< typename Address >
+constexpr int count_trailing_zeros( Address x )
+{
+   if constexpr( sizeof(Address) <= sizeof(uint64_t) )
+   {
+      return __builtin_ctzll( x );
+   }
+   else
+   {
+      uint64_t low = static_cast<uint64_t>(x);
+      return low ? __builtin_ctzll( low ) : 64 + __builtin_ctzll( static_cast<uint64_t>(x >> 64) );
+   }
+}
+
+
+// Network mask with the top prefix_length bits set, for 0 to address_bits.
+template< typename Address >
+constexpr Address prefix_length_to_mask( int prefix_length )
+{
+   return prefix_length ? static_cast<Address>(~Address( 0 ) << (address_bits<Address> - prefix_length)) : Address( 0 );
+}
+
+
+// Whether x <= y + 1 without y + 1 overflowing.
+template< typename Address >
+constexpr bool is_at_most_one_past( Address x, Address y )
+{
+   return (x == 0) | (static_cast<Address>(x - 1) <= y);
+}
+
+
+// Contiguous range of addresses [start, end] of any width.  IP_Range is the
+// IPv4 range type of the command-line tools, and additionally carries
+// non-contiguous netmasks; this is the engine shared by every family, see
+// IP6_Range.h for IPv6.
+template< typename Address >
+class Basic_IP_Range
+{
+   public:
+
+      using address_type = Address;
+
+      static constexpr Address max_address = static_cast<Address>(~Address( 0 ));
+
+      constexpr Basic_IP_Range() :
+         m_start_address( 0 ),
+         m_end_address( 0 )
+      {
+      }
+
+      static constexpr Basic_IP_Range from_start_and_end_addresses( Address start_address, Address end_address )
+      {
+         Basic_IP_Range range;
+         range.m_start_address = start_address;
+         range.m_end_address = end_address;
+         return range;
+      }
+
+      // Every address sharing the top prefix_length bits of address.
+      static constexpr Basic_IP_Range from_subnet( Address address, int prefix_length )
+      {
+         Address mask = prefix_length_to_mask<Address>( prefix_length );
+         return from_start_and_end_addresses( address & mask, address | static_cast<Address>(~mask) );
+      }
+
+      constexpr Address get_start_address() const { return m_start_address; }
+      constexpr Address get_end_address() const { return m_end_address; }
+
+      // Whether the range is exactly one aligned CIDR block.
+      constexpr bool is_subnet() const
+      {
+         Address host_bits = m_end_address - m_start_address;
+         return ((host_bits & static_cast<Address>(host_bits + 1)) == 0) && ((m_start_address & host_bits) == 0);
+      }
+
+      // Prefix length of the block, if is_subnet().
+      constexpr int prefix_length() const
+      {
+         Address host_bits = m_end_address - m_start_address;
+         return host_bits ? count_leading_zeros( host_bits ) : address_bits<Address>;
+      }
+
+      // Whether the ranges overlap or touch, in either order.
+      constexpr bool is_coalescable( const Basic_IP_Range & other ) const
+      {
+         return is_at_most_one_past( other.m_start_address, m_end_address ) &
+                is_at_most_one_past( m_start_address, other.m_end_address );
+      }
+
+      constexpr bool operator == ( const Basic_IP_Range & other ) const
+      {
+         return (m_start_address == other.m_start_address) && (m_end_address == other.m_end_address);
+      }
+
+      constexpr bool operator != ( const Basic_IP_Range & other ) const
+      {
+         return !(*this == other);
+      }
+
+      constexpr bool operator < ( const Basic_IP_Range & rhs ) const
+      {
+         return (m_start_address != rhs.m_start_address) ? (m_start_address < rhs.m_start_address)
+                                                         : (m_end_address < rhs.m_end_address);
+      }
+
+      // Widens the range to cover other too; only meaningful when the two
+      // are coalescable.
+      constexpr Basic_IP_Range & operator += ( const Basic_IP_Range & other )
+      {
+         m_start_address = std::min( m_start_address, other.m_start_address );
+         m_end_address = std::max( m_end_address, other.m_end_address );
+         return *this;
+      }
+
+   private:
+
+      Address m_start_address;
+      Address m_end_address;
+};
+
+
+// Coalesces the sorted ranges in [first, last) in place, returning the end of
+// the result.  The ranges are Basic_IP_Range or anything else with its
+// accessors and from_start_and_end_addresses(), such as IP_Range, so every
+// family runs the same loop.
+template< typename Range_Iterator >
+Range_Iterator coalesce_sorted_ranges( Range_Iterator first, Range_Iterator last )
+{
+   using Range = typename std::iterator_traits<Range_Iterator>::value_type;
+
+   auto coalesced_end = first;
+
+   for( auto iter = first; iter != last; iter++ )
+   {
+      if( (coalesced_end != first) &&
+          is_at_most_one_past( iter->get_start_address(), std::prev(coalesced_end)->get_end_address() ) )
+      {
+         // Unconditional, as the ends of overlapping input are unpredictable.
+         Range & previous = *std::prev(coalesced_end);
+         previous = Range::from_start_and_end_addresses(
+            previous.get_start_address(), std::max( previous.get_end_address(), iter->get_end_address() ) );
+      }
+      else
+      {
+         *coalesced_end++ = *iter;
+      }
+   }
+
+   return coalesced_end;
+}
+
+
+// Sorts and coalesces the ranges in place, leaving them in ascending order.
+template< typename Address >
+void sort_and_coalesce( std::vector<Basic_IP_Range<Address>> & ranges )
+{
+   std::sort( ranges.begin(), ranges.end() );
+   ranges.erase( coalesce_sorted_ranges( ranges.begin(), ranges.end() ), ranges.end() );
+}
+
+
+// Appends to blocks the fewest aligned CIDR blocks that together cover exactly
+// [start, end], in ascending order, each found in constant time.  Block is
+// Basic_IP_Range<Address> or another type with from_start_and_end_addresses().
+// Throws std::invalid_argument if end < start, which would otherwise wrap
+// around the address space.
+template< typename Address, typename Block >
+void append_cidr_blocks( Address start, const Address end, std::vector<Block> & blocks )
+{
+   constexpr int bits = address_bits<Address>;
+
+   if( end < start ) throw std::invalid_argument( "Range end address precedes its start address." );
+
+   for( ;; )
+   {
+      // Block size as a power of two: the smaller of the largest aligned at
+      // start and the largest that fits in what is left.
+      Address remaining = static_cast<Address>(end - start + 1);
+      int aligned_bits = start ? count_trailing_zeros( start ) : bits;
+      int fitting_bits = remaining ? (bits - 1 - count_leading_zeros( remaining )) : bits;
+      int block_bits = std::min( aligned_bits, fitting_bits );
+
+      Address block_end = start | static_cast<Address>(~prefix_length_to_mask<Address>( bits - block_bits ));
+      blocks.push_back( Block::from_start_and_end_addresses( start, block_end ) );
+
+      if( block_end == end ) break;
+      start = block_end + 1;
+   }
+}
+
+
+template< typename Address >
+void append_cidr_blocks( const Basic_IP_Range<Address> & range, std::vector<Basic_IP_Range<Address>> & blocks )
+{
+   append_cidr_blocks( range.get_start_address(), range.get_end_address(), blocks );
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* BASIC_IP_RANGE_H */
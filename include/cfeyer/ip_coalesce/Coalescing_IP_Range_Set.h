@@ -23,7 +23,10 @@
 #ifndef COALESCING_IP_RANGE_SET_H
 #define COALESCING_IP_RANGE_SET_H
 
+#include <cstdint>
 #include <set>
+#include <vector>
+#include <iterator>
 
 #include <cfeyer/ip_coalesce/IP_Range.h>
 
@@ -32,22 +35,136 @@ namespace ip_coalesce {
 
 using IP_Range_Set = std::set<IP_Range>;
 
+// Sorts and coalesces the ranges in place, leaving them in ascending order.
+// Ranges with non-contiguous subnet masks are kept but never coalesced.
+void sort_and_coalesce( std::vector<IP_Range> & ranges );
+
+// Same result as above, but sorts and coalesces slices of the input on up to
+// thread_count threads before merging them.  Zero means one thread per core.
+void sort_and_coalesce( std::vector<IP_Range> & ranges, unsigned thread_count );
+
 class Coalescing_IP_Range_Set
 {
    public:
 
+      // Running totals since the set was built.  A merge is a range that
+      // coalesced into another, or duplicated one, rather than being stored
+      // on its own.
+      struct Statistics
+      {
+         uint64_t ranges_inserted = 0;
+         uint64_t merges = 0;
+      };
+
+      static Coalescing_IP_Range_Set build( std::vector<IP_Range> && ranges,
+                                            unsigned thread_count = 1 );
+
       void insert( const IP_Range & range );
 
+      template< typename Input_Iterator >
+      void insert( Input_Iterator first, Input_Iterator last );
+
+      // Removes every address of range, trimming or splitting the stored
+      // ranges it partly covers.  A range with a non-contiguous subnet mask
+      // is an address pattern, and erasing one removes that same pattern
+      // only; erasing a contiguous range leaves stored patterns alone.
+      void erase( const IP_Range & range );
+
+      // Removes the address from the range holding it, if any.
+      void erase( uint32_t address );
+
       int size() const;
 
       IP_Range_Set::const_iterator begin() const;
       IP_Range_Set::const_iterator end() const;
 
+      // Lookups binary search the ranges with contiguous subnet masks, which
+      // are sorted, disjoint and non-adjacent.  Ranges with non-contiguous
+      // masks are address patterns rather than intervals and never match.
+
+      // Returns the range holding address, or end() if there is none.
+      IP_Range_Set::const_iterator find( uint32_t address ) const;
+
+      bool contains( uint32_t address ) const;
+
+      // Whether every address of range is in the set.  Always false for a
+      // range with a non-contiguous subnet mask.
+      bool contains( const IP_Range & range ) const;
+
+      // Sets results[i] to contains( sorted_addresses[i] ) for addresses in
+      // ascending order, in one pass over the set.
+      void contains( const std::vector<uint32_t> & sorted_addresses, std::vector<bool> & results ) const;
+
+      const Statistics & get_statistics() const;
+
    private:
 
+      friend Coalescing_IP_Range_Set set_union( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b );
+      friend Coalescing_IP_Range_Set set_intersection( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b );
+      friend Coalescing_IP_Range_Set set_difference( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b );
+      friend Coalescing_IP_Range_Set complement( const Coalescing_IP_Range_Set & a );
+      friend class IP_Range_Snapshot;
+
+      // Set of already coalesced contiguous ranges and sorted, unique
+      // non-contiguous ones, in linear time.
+      static Coalescing_IP_Range_Set from_coalesced( const std::vector<IP_Range> & contiguous_ranges,
+                                                     const std::vector<IP_Range> & noncontiguous_ranges );
+
+      // Erases the stored contiguous range at iter, putting back the parts of
+      // it outside start_address to end_address.  Returns the iterator after
+      // what was put back.
+      IP_Range_Set::iterator erase_addresses( IP_Range_Set::iterator iter,
+                                              uint32_t start_address, uint32_t end_address );
+
+      // Stores a contiguous range at hint, in place of any non-contiguous one
+      // with the same bounds, as build() keeps the contiguous one.  Returns
+      // the iterator after it.
+      IP_Range_Set::iterator store_contiguous( IP_Range_Set::iterator hint, const IP_Range & range );
+
       IP_Range_Set m_ranges;
+      Statistics m_statistics;
 };
 
+
+// Set algebra on coalesced sets, each a single linear merge over the sorted
+// ranges producing coalesced output directly.  A range with a non-contiguous
+// subnet mask is an address pattern rather than an interval, so it takes part
+// only as a whole: it is in a union if in either set, an intersection if in
+// both, and a difference if in a but not b.  complement() covers the
+// addresses outside the contiguous ranges and drops non-contiguous ones.
+Coalescing_IP_Range_Set set_union( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b );
+Coalescing_IP_Range_Set set_intersection( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b );
+Coalescing_IP_Range_Set set_difference( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b );
+Coalescing_IP_Range_Set complement( const Coalescing_IP_Range_Set & a );
+
+
+template< typename Input_Iterator >
+void Coalescing_IP_Range_Set::insert( Input_Iterator first, Input_Iterator last )
+{
+   std::vector<IP_Range> ranges( first, last );
+
+   if( ranges.size() < m_ranges.size() )
+   {
+      for( const IP_Range & range : ranges )
+      {
+         insert( range );
+      }
+   }
+   else
+   {
+      Statistics statistics = m_statistics;
+      statistics.ranges_inserted += ranges.size();
+
+      const uint64_t stored_count = m_ranges.size() + ranges.size();
+
+      ranges.insert( ranges.end(), m_ranges.begin(), m_ranges.end() );
+      *this = build( std::move(ranges) );
+
+      statistics.merges += stored_count - m_ranges.size();
+      m_statistics = statistics;
+   }
+}
+
 } // namespace ip_coalesce
 } // namespace cfeyer
 
@@ -0,0 +1,93 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef DIR_24_8_TABLE_H
+#define DIR_24_8_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Constant-time address membership table compiled from a finished set, in the
+// two-level DIR-24-8 layout: one first-level entry for each /24, and for any
+// /24 the set only partly covers, a 256-bit second-level chunk holding the
+// /25 to /32 detail.  Every lookup is one or two memory reads.  The first
+// level alone takes 64 MiB.  As with Coalescing_IP_Range_Set::find(), ranges
+// with non-contiguous subnet masks are not included.
+class DIR_24_8_Table
+{
+   public:
+
+      static DIR_24_8_Table build( const Coalescing_IP_Range_Set & set );
+
+      bool contains( uint32_t address ) const;
+
+      // Number of /24s with a second-level chunk.
+      std::size_t chunk_count() const;
+
+      // Bytes held by both levels.
+      std::size_t memory_bytes() const;
+
+   private:
+
+      struct Chunk
+      {
+         uint64_t bits[4];
+      };
+
+      // First-level entries are absent, present, or the index of the chunk
+      // plus first_chunk_entry.
+      static constexpr uint32_t absent_entry = 0;
+      static constexpr uint32_t present_entry = 1;
+      static constexpr uint32_t first_chunk_entry = 2;
+
+      void add( uint32_t start_address, uint32_t end_address );
+      void add_within_slash_24( uint32_t start_address, uint32_t end_address );
+
+      std::vector<uint32_t> m_first_level;
+      std::vector<Chunk> m_chunks;
+};
+
+
+inline bool DIR_24_8_Table::contains( uint32_t address ) const
+{
+   uint32_t entry = m_first_level[address >> 8];
+
+   if( entry < first_chunk_entry )
+   {
+      return (entry == present_entry);
+   }
+
+   const Chunk & chunk = m_chunks[entry - first_chunk_entry];
+   return (chunk.bits[(address >> 6) & 3] >> (address & 63)) & 1;
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* DIR_24_8_TABLE_H */
@@ -0,0 +1,121 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef FLAT_IP_RANGE_SET_H
+#define FLAT_IP_RANGE_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <iterator>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Coalescing set that keeps its ranges in sorted, already-coalesced order in
+// two parallel arrays of start and end addresses instead of a node-based tree.
+// Ranges with non-contiguous subnet masks are never coalesced and are kept on
+// the side; iteration merges both back into IP_Range order.
+class Flat_IP_Range_Set
+{
+   public:
+
+      class const_iterator
+      {
+         public:
+
+            using iterator_category = std::input_iterator_tag;
+            using value_type = IP_Range;
+            using difference_type = std::ptrdiff_t;
+            using reference = IP_Range;
+
+            class pointer
+            {
+               public:
+                  const IP_Range * operator -> () const { return &m_range; }
+               private:
+                  friend class const_iterator;
+                  explicit pointer( const IP_Range & range ) : m_range( range ) {}
+                  IP_Range m_range;
+            };
+
+            const_iterator();
+
+            reference operator * () const;
+            pointer operator -> () const;
+
+            const_iterator & operator ++ ();
+            const_iterator operator ++ ( int );
+
+            bool operator == ( const const_iterator & other ) const;
+            bool operator != ( const const_iterator & other ) const;
+
+         private:
+
+            friend class Flat_IP_Range_Set;
+
+            const_iterator( const Flat_IP_Range_Set * set,
+                            std::size_t contiguous_index,
+                            std::size_t noncontiguous_index );
+
+            bool is_at_contiguous_range() const;
+
+            const Flat_IP_Range_Set * m_set;
+            std::size_t m_contiguous_index;
+            std::size_t m_noncontiguous_index;
+      };
+
+      static Flat_IP_Range_Set build( std::vector<IP_Range> && ranges );
+
+      void insert( const IP_Range & range );
+
+      template< typename Input_Iterator >
+      void insert( Input_Iterator first, Input_Iterator last );
+
+      int size() const;
+
+      const_iterator begin() const;
+      const_iterator end() const;
+
+   private:
+
+      std::vector<uint32_t> m_start_addresses;
+      std::vector<uint32_t> m_end_addresses;
+
+      std::vector<IP_Range> m_noncontiguous_ranges;
+};
+
+
+template< typename Input_Iterator >
+void Flat_IP_Range_Set::insert( Input_Iterator first, Input_Iterator last )
+{
+   std::vector<IP_Range> ranges( first, last );
+   ranges.insert( ranges.end(), begin(), end() );
+   *this = build( std::move(ranges) );
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* FLAT_IP_RANGE_SET_H */
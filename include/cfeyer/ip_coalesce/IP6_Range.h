@@ -0,0 +1,77 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef IP6_RANGE_H
+#define IP6_RANGE_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/Basic_IP_Range.h>
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+using IP6_Address = unsigned __int128;
+using IP6_Range = Basic_IP_Range<IP6_Address>;
+
+// Longest string format_range() can produce for an IPv6 range, as in two
+// full eight-group addresses joined by '-'.
+constexpr std::size_t max_ip6_range_string_length = 79;
+
+// Parses an IPv6 address ("2001:db8::1", with "::" compression and an
+// optional trailing dotted quad), an address with a prefix length
+// ("2001:db8::/32"), or two addresses joined by '-'.  A prefix length takes
+// the whole block holding the address.  Returns false, leaving range
+// unchanged, if str is not one of these.
+bool try_parse_ip6_range( std::string_view str, IP6_Range & range );
+
+// As above, but throws std::runtime_error if str does not parse.
+IP6_Range parse_ip6_range( std::string_view str );
+
+// Writes range in RFC 5952 form at out, which must have room for
+// max_ip6_range_string_length characters: an address for a single address,
+// a prefix for a CIDR block, and start-end otherwise.  Returns one past the
+// last character written.
+char * format_range( char * out, const IP6_Range & range );
+
+// Writes a CIDR block in prefix form, "/128" included.  block must be one of
+// those append_cidr_blocks() produces.
+char * format_cidr_block( char * out, const IP6_Range & block );
+
+std::string to_string( const IP6_Range & range );
+
+std::ostream & operator << ( std::ostream & strm, const IP6_Range & range );
+
+// Like parse_ranges() above, but tokens that are not IPv4 ranges are parsed
+// as IPv6 ranges into ip6_ranges.  IPv4 tokens cost no more than before.
+void parse_ranges( std::string_view text, std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges );
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* IP6_RANGE_H */
@@ -23,8 +23,11 @@
 #ifndef IP_RANGE_H
 #define IP_RANGE_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <iosfwd>
 
 namespace cfeyer {
@@ -37,14 +40,22 @@ class IP_Range
       IP_Range();
       IP_Range( uint32_t subnet_address, uint32_t subnet_mask );
 
+      // Throws std::logic_error if end_address < start_address.
+      static IP_Range from_start_and_end_addresses( uint32_t start_address, uint32_t end_address );
+
       uint32_t get_start_address() const;
       uint32_t get_end_address() const;
 
-      void from_string( const std::string & str );
-      bool from_four_octet_address_slash_four_octet_netmask_string( const std::string & str );
-      bool from_four_octet_address_slash_netmask_length_string( const std::string & str );
-      bool from_four_octet_address_no_netmask_string( const std::string & str );
-      bool from_four_octet_address_dash_four_octet_address_string( const std::string & str );
+      void from_string( std::string_view str );
+      bool try_from_string( std::string_view str );
+      bool from_four_octet_address_slash_four_octet_netmask_string( std::string_view str );
+      bool from_four_octet_address_slash_netmask_length_string( std::string_view str );
+      bool from_four_octet_address_no_netmask_string( std::string_view str );
+      bool from_four_octet_address_dash_four_octet_address_string( std::string_view str );
+
+      // Longest string to_string() or format_range() can produce, as in
+      // "255.255.255.255/255.255.255.255".
+      static constexpr std::size_t max_string_length = 31;
 
       std::string to_string() const;
 
@@ -52,6 +63,11 @@ class IP_Range
 
       bool is_subnet() const;
 
+      bool has_contiguous_subnet_mask() const;
+
+      // The subnet mask of a range with a non-contiguous one, else zero.
+      uint32_t get_noncontiguous_subnet_mask() const;
+
       uint64_t size() const;
 
       bool operator == ( const IP_Range & other ) const;
@@ -62,6 +78,8 @@ class IP_Range
    private:
 
       friend IP_Range operator + ( const IP_Range & a, const IP_Range & b );
+      friend char * format_range( char * out, const IP_Range & range );
+      friend char * format_cidr_block( char * out, const IP_Range & block );
 
       uint32_t m_start_address;
       uint32_t m_end_address;
@@ -69,14 +87,36 @@ class IP_Range
       static constexpr uint32_t contiguous_subnet_mask = 0;
       uint32_t m_noncontiguous_subnet_mask;
 
-      std::string to_start_dash_end() const;
-      std::string to_start_slash_subnet_mask() const;
-      std::string to_cidr() const;
+      char * format_start_dash_end( char * out ) const;
+      char * format_start_slash_subnet_mask( char * out ) const;
+      char * format_cidr( char * out ) const;
 };
 
 std::istream & operator >> ( std::istream & strm, IP_Range & range );
 std::ostream & operator << ( std::ostream & strm, const IP_Range & range );
 
+// Writes range as to_string() would at out, which must have room for
+// IP_Range::max_string_length characters, without allocating.  Returns one
+// past the last character written.
+char * format_range( char * out, const IP_Range & range );
+
+// Writes a CIDR block in prefix form, "/32" included, as format_range()
+// does.  block must be one of those append_cidr_blocks() produces.
+char * format_cidr_block( char * out, const IP_Range & block );
+
+// Appends to blocks the fewest aligned CIDR blocks that together cover exactly
+// the addresses in range, in ascending order, each found in constant time.
+// Throws std::invalid_argument for a range with a non-contiguous subnet mask,
+// which has no CIDR form.
+void append_cidr_blocks( const IP_Range & range, std::vector<IP_Range> & blocks );
+
+// Parses every whitespace-separated range in text, appending them to ranges.
+// Delimiters are located many bytes at a time, and the dotted quads of the
+// usual a.b.c.d, a.b.c.d/n and a.b.c.d-e.f.g.h forms converted, with SIMD
+// where the CPU has it.
+// Throws std::runtime_error at the first token that fails to parse.
+void parse_ranges( std::string_view text, std::vector<IP_Range> & ranges );
+
 } // namespace ip_coalesce
 } // namespace cfeyer
 
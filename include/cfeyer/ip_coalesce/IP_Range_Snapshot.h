@@ -0,0 +1,191 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef IP_RANGE_SNAPSHOT_H
+#define IP_RANGE_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Binary snapshot of a coalesced IPv4 set, in host byte order:
+//
+//    Snapshot_Header
+//    range_count                 Snapshot_Range    ascending, disjoint and
+//                                                  non-adjacent contiguous ranges
+//    noncontiguous_range_count   Snapshot_Range    start address and subnet mask
+//                                                  of each non-contiguous range,
+//                                                  ascending
+//
+// The contiguous ranges are laid out to be searched where they lie once the
+// file is mapped, with no parsing.
+
+struct Snapshot_Header
+{
+   static constexpr char expected_magic[8] = { 'I', 'P', 'C', 'O', 'A', 'L', 'S', 'S' };
+   static constexpr uint32_t current_version = 1;
+
+   // Set in flags when there are ranges with non-contiguous subnet masks.
+   static constexpr uint32_t has_noncontiguous_ranges = 1;
+
+   char magic[8];
+   uint32_t version;
+   uint32_t flags;
+   uint64_t range_count;
+   uint64_t noncontiguous_range_count;
+};
+
+struct Snapshot_Range
+{
+   uint32_t first;
+   uint32_t second;
+};
+
+
+class Range_Writer;
+
+// Writes a snapshot from ranges given in Coalescing_IP_Range_Set order, so a
+// set can be saved as it streams out of a coalescer.  Non-contiguous ranges
+// are held in memory until finish().  The snapshot is written to a temporary
+// file beside path and renamed over it by finish(), so path keeps its old
+// contents until then, even while it is being read.
+class Snapshot_Writer
+{
+   public:
+
+      explicit Snapshot_Writer( const std::string & path );
+      ~Snapshot_Writer();
+
+      Snapshot_Writer( const Snapshot_Writer & ) = delete;
+      Snapshot_Writer & operator = ( const Snapshot_Writer & ) = delete;
+
+      // Throws std::invalid_argument if a contiguous range does not start
+      // past the end of the one before, plus one.
+      void add( const IP_Range & range );
+
+      // Writes the rest of the snapshot and its header, and moves it to path.
+      // Without it path is left as it was.
+      void finish();
+
+   private:
+
+      std::string m_path;
+      std::string m_temporary_path;
+      int m_fd;
+      bool m_is_finished;
+      std::unique_ptr<Range_Writer> m_writer;
+
+      uint64_t m_range_count;
+      uint64_t m_next_start_address;
+      std::vector<Snapshot_Range> m_noncontiguous_ranges;
+};
+
+
+void save_snapshot( const std::string & path, const Coalescing_IP_Range_Set & set );
+
+
+// Read-only view of a memory-mapped snapshot.  Opening checks the header and
+// the file size only, so it takes the same time at any size; lookups binary
+// search the mapped ranges directly.
+class IP_Range_Snapshot
+{
+   public:
+
+      // Throws std::system_error if the file cannot be mapped and
+      // std::runtime_error if it is not a snapshot of a known version.
+      explicit IP_Range_Snapshot( const std::string & path );
+      ~IP_Range_Snapshot();
+
+      IP_Range_Snapshot( const IP_Range_Snapshot & ) = delete;
+      IP_Range_Snapshot & operator = ( const IP_Range_Snapshot & ) = delete;
+
+      // Number of ranges of both kinds.
+      std::size_t size() const;
+
+      // As Coalescing_IP_Range_Set::contains(): ranges with non-contiguous
+      // subnet masks never match.
+      bool contains( uint32_t address ) const;
+
+      // Calls output with every range in Coalescing_IP_Range_Set order.
+      template< typename Output >
+      void for_each( Output output ) const;
+
+      Coalescing_IP_Range_Set to_set() const;
+
+   private:
+
+      const void * m_mapping;
+      std::size_t m_mapping_size;
+
+      const Snapshot_Range * m_ranges;
+      std::size_t m_range_count;
+
+      const Snapshot_Range * m_noncontiguous_ranges;
+      std::size_t m_noncontiguous_range_count;
+};
+
+
+template< typename Output >
+void IP_Range_Snapshot::for_each( Output output ) const
+{
+   const Snapshot_Range * range = m_ranges;
+   const Snapshot_Range * ranges_end = m_ranges + m_range_count;
+
+   const Snapshot_Range * noncontiguous_range = m_noncontiguous_ranges;
+   const Snapshot_Range * noncontiguous_ranges_end = m_noncontiguous_ranges + m_noncontiguous_range_count;
+
+   while( (range != ranges_end) || (noncontiguous_range != noncontiguous_ranges_end) )
+   {
+      IP_Range next_noncontiguous_range;
+
+      if( noncontiguous_range != noncontiguous_ranges_end )
+      {
+         next_noncontiguous_range = IP_Range( noncontiguous_range->first, noncontiguous_range->second );
+      }
+
+      if( (range != ranges_end) &&
+          ((noncontiguous_range == noncontiguous_ranges_end) ||
+           !(next_noncontiguous_range < IP_Range::from_start_and_end_addresses( range->first, range->second ))) )
+      {
+         output( IP_Range::from_start_and_end_addresses( range->first, range->second ) );
+         range++;
+      }
+      else
+      {
+         output( next_noncontiguous_range );
+         noncontiguous_range++;
+      }
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* IP_RANGE_SNAPSHOT_H */
@@ -0,0 +1,178 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef RANGE_SET_ALGEBRA_H
+#define RANGE_SET_ALGEBRA_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/Basic_IP_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Set algebra over coalesced range lists: ascending, disjoint, non-adjacent
+// contiguous ranges, as sort_and_coalesce() leaves them.  Each operation is
+// one linear merge over its inputs and appends a list of the same form to
+// out.  Range is IP_Range (contiguous masks only) or any Basic_IP_Range.
+
+template< typename Range >
+using Range_Address = decltype( std::declval<Range>().get_start_address() );
+
+
+template< typename Range >
+void append_union( const std::vector<Range> & a, const std::vector<Range> & b, std::vector<Range> & out )
+{
+   using Address = Range_Address<Range>;
+
+   auto a_iter = a.begin();
+   auto b_iter = b.begin();
+   const std::size_t out_begin = out.size();
+
+   while( (a_iter != a.end()) || (b_iter != b.end()) )
+   {
+      const Range & next = ((b_iter == b.end()) ||
+                            ((a_iter != a.end()) && (a_iter->get_start_address() <= b_iter->get_start_address())))
+                           ? *a_iter++ : *b_iter++;
+
+      if( (out.size() > out_begin) &&
+          is_at_most_one_past<Address>( next.get_start_address(), out.back().get_end_address() ) )
+      {
+         if( next.get_end_address() > out.back().get_end_address() )
+         {
+            out.back() = Range::from_start_and_end_addresses( out.back().get_start_address(), next.get_end_address() );
+         }
+      }
+      else
+      {
+         out.push_back( next );
+      }
+   }
+}
+
+
+template< typename Range >
+void append_intersection( const std::vector<Range> & a, const std::vector<Range> & b, std::vector<Range> & out )
+{
+   auto a_iter = a.begin();
+   auto b_iter = b.begin();
+
+   while( (a_iter != a.end()) && (b_iter != b.end()) )
+   {
+      auto start = std::max( a_iter->get_start_address(), b_iter->get_start_address() );
+      auto end = std::min( a_iter->get_end_address(), b_iter->get_end_address() );
+
+      if( start <= end )
+      {
+         out.push_back( Range::from_start_and_end_addresses( start, end ) );
+      }
+
+      // Whichever range ends first cannot overlap anything further along.
+      if( a_iter->get_end_address() < b_iter->get_end_address() )
+      {
+         a_iter++;
+      }
+      else
+      {
+         b_iter++;
+      }
+   }
+}
+
+
+// Addresses in a but not in b.
+template< typename Range >
+void append_difference( const std::vector<Range> & a, const std::vector<Range> & b, std::vector<Range> & out )
+{
+   auto b_iter = b.begin();
+
+   for( const Range & range : a )
+   {
+      auto start = range.get_start_address();
+      const auto end = range.get_end_address();
+      bool is_exhausted = false;
+
+      while( (b_iter != b.end()) && (b_iter->get_end_address() < start) )
+      {
+         b_iter++;
+      }
+
+      // Cut each overlapping range of b out of what is left of range.
+      while( (b_iter != b.end()) && (b_iter->get_start_address() <= end) )
+      {
+         if( b_iter->get_start_address() > start )
+         {
+            out.push_back( Range::from_start_and_end_addresses( start, b_iter->get_start_address() - 1 ) );
+         }
+
+         if( b_iter->get_end_address() >= end )
+         {
+            is_exhausted = true;
+            break;
+         }
+
+         start = b_iter->get_end_address() + 1;
+         b_iter++;
+      }
+
+      if( !is_exhausted )
+      {
+         out.push_back( Range::from_start_and_end_addresses( start, end ) );
+      }
+   }
+}
+
+
+// Addresses of the whole address space not in a.
+template< typename Range >
+void append_complement( const std::vector<Range> & a, std::vector<Range> & out )
+{
+   using Address = Range_Address<Range>;
+
+   constexpr Address max_address = static_cast<Address>(~Address( 0 ));
+
+   Address start = 0;
+
+   for( const Range & range : a )
+   {
+      if( range.get_start_address() > start )
+      {
+         out.push_back( Range::from_start_and_end_addresses( start, range.get_start_address() - 1 ) );
+      }
+
+      if( range.get_end_address() == max_address )
+      {
+         return;
+      }
+
+      start = range.get_end_address() + 1;
+   }
+
+   out.push_back( Range::from_start_and_end_addresses( start, max_address ) );
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* RANGE_SET_ALGEBRA_H */
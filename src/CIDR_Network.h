@@ -20,28 +20,81 @@
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //  THE SOFTWARE.
 
+
 #ifndef CIDR_NETWORK_H
 #define CIDR_NETWORK_H
 
 #include <cstdint>
+#include <stdexcept>
 
 namespace cfeyer {
 namespace ip_coalesce {
 
-uint32_t subnet_start_address( uint32_t subnet_address, uint32_t subnet_mask );
-uint32_t subnet_end_address( uint32_t subnet_address, uint32_t subnet_mask );
+// Subnet math runs for every parsed range, so it is all constexpr and inline
+// here, built on the bit-counting builtins rather than loops over the bits.
 
 constexpr int noncontiguous_subnet_mask = -1;
-int count_contiguous_network_ones( uint32_t subnet_mask );
 
-uint64_t netmask_length_to_address_count( int netmask_length_bits );
+// Number of leading ones in subnet_mask, or noncontiguous_subnet_mask if any
+// one follows a zero.
+constexpr int count_contiguous_network_ones( uint32_t subnet_mask )
+{
+   // The host part of a contiguous mask, inverted, is a run of low ones, so
+   // adding one to it carries out of every bit it has set.
+   uint32_t host_bits = ~subnet_mask;
+
+   return ((host_bits & (host_bits + 1)) == 0) ? __builtin_popcount( subnet_mask )
+                                               : noncontiguous_subnet_mask;
+}
+
+
+constexpr uint64_t netmask_length_to_address_count( int netmask_length_bits )
+{
+   return uint64_t( 1 ) << (32 - netmask_length_bits);
+}
+
+
+constexpr uint32_t subnet_start_address( uint32_t subnet_address, uint32_t subnet_mask )
+{
+   return (count_contiguous_network_ones( subnet_mask ) != noncontiguous_subnet_mask) ?
+          (subnet_address & subnet_mask) : subnet_address;
+}
+
+
+constexpr uint32_t subnet_end_address( uint32_t subnet_address, uint32_t subnet_mask )
+{
+   return (count_contiguous_network_ones( subnet_mask ) != noncontiguous_subnet_mask) ?
+          (subnet_address | ~subnet_mask) : subnet_address;
+}
+
+
+constexpr bool is_power_of_2( uint64_t x )
+{
+   return (x != 0) && ((x & (x - 1)) == 0);
+}
+
+
+constexpr int log_base_2( uint64_t x )
+{
+   if( !is_power_of_2(x) ) throw std::domain_error( "Argument to log_base_2() must be power of two." );
+
+   return __builtin_ctzll( x );
+}
+
+
+constexpr uint32_t size_to_subnet_mask( uint64_t size )
+{
+   if( size > 0x100000000 ) throw std::domain_error( "Size of subnet cannot exceed 2^32." );
 
-bool is_subnet( uint32_t address, uint64_t size );
+   return static_cast<uint32_t>( 0xffffffffULL << log_base_2( size ) );
+}
 
-bool is_power_of_2( uint64_t x );
-int log_base_2( uint64_t x );
 
-uint32_t size_to_subnet_mask( uint64_t size );
+// Whether size addresses starting at address make up a CIDR subnet.
+constexpr bool is_subnet( uint32_t address, uint64_t size )
+{
+   return is_power_of_2( size ) && (address == (address & size_to_subnet_mask( size )));
+}
 
 
 } // namespace ip_coalesce
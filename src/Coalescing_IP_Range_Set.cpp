@@ -21,43 +21,391 @@
 //  THE SOFTWARE.
 
 #include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+#include <cfeyer/ip_coalesce/Range_Set_Algebra.h>
+#include <cfeyer/ip_coalesce/Basic_IP_Range.h>
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
 
 namespace cfeyer {
 namespace ip_coalesce {
 
+namespace {
+
+// IP_Range::is_coalescable() only checks whether the other range's end points
+// fall on or next to this range, so a range that strictly encloses another is
+// caught by testing in both directions.
+bool is_mutually_coalescable( const IP_Range & a, const IP_Range & b )
+{
+   return a.is_coalescable( b ) || b.is_coalescable( a );
+}
+
+
+IP_Range coalesce( const IP_Range & a, const IP_Range & b )
+{
+   return a.is_coalescable( b ) ? (a + b) : (b + a);
+}
+
+
+
+using Range_Iterator = std::vector<IP_Range>::iterator;
+
+
+bool has_contiguous_subnet_mask( const IP_Range & range )
+{
+   return range.has_contiguous_subnet_mask();
+}
+
+
+// Coalesces [first, last) whose ranges with contiguous subnet masks are sorted
+// in [first, noncontiguous_begin) and the rest sorted in
+// [noncontiguous_begin, last).  Leaves the result sorted and returns its end.
+Range_Iterator coalesce_partitioned( Range_Iterator first,
+                                     Range_Iterator noncontiguous_begin,
+                                     Range_Iterator last )
+{
+   auto coalesced_end = coalesce_sorted_ranges( first, noncontiguous_begin );
+
+   auto noncontiguous_end = std::unique( noncontiguous_begin, last );
+   auto merge_middle = coalesced_end;
+
+   coalesced_end = std::move( noncontiguous_begin, noncontiguous_end, coalesced_end );
+
+   std::inplace_merge( first, merge_middle, coalesced_end );
+
+   return coalesced_end;
+}
+
+
+Range_Iterator sort_and_coalesce( Range_Iterator first, Range_Iterator last )
+{
+   auto noncontiguous_begin = std::partition( first, last, has_contiguous_subnet_mask );
+
+   std::sort( first, noncontiguous_begin );
+   std::sort( noncontiguous_begin, last );
+
+   return coalesce_partitioned( first, noncontiguous_begin, last );
+}
+
+
+// Coalesces a sorted [first, last), such as the merged output of several
+// independently coalesced slices.
+Range_Iterator coalesce_sorted( Range_Iterator first, Range_Iterator last )
+{
+   auto noncontiguous_begin = std::stable_partition( first, last, has_contiguous_subnet_mask );
+
+   return coalesce_partitioned( first, noncontiguous_begin, last );
+}
+
+
+// Runs task(i) for each i in [0, count) on its own thread.
+template< typename Task >
+void run_in_parallel( std::size_t count, Task task )
+{
+   std::vector<std::thread> threads;
+   threads.reserve( count );
+
+   for( std::size_t i = 0; i < count; i++ )
+   {
+      threads.emplace_back( task, i );
+   }
+
+   for( std::thread & thread : threads )
+   {
+      thread.join();
+   }
+}
+
+
+// Splits the sorted ranges of a coalesced set by the kind of subnet mask,
+// keeping each part sorted.
+void split_by_subnet_mask( const Coalescing_IP_Range_Set & set,
+                           std::vector<IP_Range> & contiguous_ranges,
+                           std::vector<IP_Range> & noncontiguous_ranges )
+{
+   for( const IP_Range & range : set )
+   {
+      if( range.has_contiguous_subnet_mask() )
+      {
+         contiguous_ranges.push_back( range );
+      }
+      else
+      {
+         noncontiguous_ranges.push_back( range );
+      }
+   }
+}
+
+} // namespace
+
+
+void sort_and_coalesce( std::vector<IP_Range> & ranges )
+{
+   ranges.erase( sort_and_coalesce( ranges.begin(), ranges.end() ), ranges.end() );
+}
+
+
+void sort_and_coalesce( std::vector<IP_Range> & ranges, unsigned thread_count )
+{
+   static constexpr std::size_t min_ranges_per_thread = 4096;
+
+   if( thread_count == 0 )
+   {
+      thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+   }
+
+   std::size_t slice_count =
+      std::min<std::size_t>( thread_count, ranges.size() / min_ranges_per_thread );
+
+   if( slice_count < 2 )
+   {
+      sort_and_coalesce( ranges );
+      return;
+   }
+
+   // Sort and coalesce equal slices of the input independently.
+   std::vector<Range_Iterator> slice_begins( slice_count + 1 );
+   std::vector<Range_Iterator> slice_ends( slice_count );
+
+   for( std::size_t i = 0; i <= slice_count; i++ )
+   {
+      slice_begins[i] = ranges.begin() + (ranges.size() * i / slice_count);
+   }
+
+   run_in_parallel( slice_count, [&]( std::size_t i ) {
+      slice_ends[i] = sort_and_coalesce( slice_begins[i], slice_begins[i+1] );
+   } );
+
+   // Close the gaps left behind by coalescing so the slices are contiguous.
+   auto compacted_end = slice_ends[0];
+
+   for( std::size_t i = 1; i < slice_count; i++ )
+   {
+      auto slice_begin = slice_begins[i];
+      slice_begins[i] = compacted_end;
+      compacted_end = std::move( slice_begin, slice_ends[i], compacted_end );
+   }
+
+   slice_begins[slice_count] = compacted_end;
+
+   // Merge neighboring slices pairwise until one sorted run is left, then fix
+   // up the slice boundaries with a final coalescing sweep.
+   while( slice_begins.size() > 2 )
+   {
+      std::size_t pair_count = (slice_begins.size() - 1) / 2;
+
+      run_in_parallel( pair_count, [&]( std::size_t i ) {
+         std::inplace_merge( slice_begins[2*i], slice_begins[2*i+1], slice_begins[2*i+2] );
+      } );
+
+      std::vector<Range_Iterator> merged_begins;
+
+      for( std::size_t i = 0; i < slice_begins.size(); i += 2 )
+      {
+         merged_begins.push_back( slice_begins[i] );
+      }
+
+      if( merged_begins.back() != compacted_end )
+      {
+         merged_begins.push_back( compacted_end );
+      }
+
+      slice_begins.swap( merged_begins );
+   }
+
+   ranges.erase( coalesce_sorted( ranges.begin(), compacted_end ), ranges.end() );
+}
+
+
+Coalescing_IP_Range_Set Coalescing_IP_Range_Set::build( std::vector<IP_Range> && ranges,
+                                                         unsigned thread_count )
+{
+   const uint64_t input_count = ranges.size();
+
+   sort_and_coalesce( ranges, thread_count );
+
+   Coalescing_IP_Range_Set set;
+   set.m_ranges = IP_Range_Set( ranges.begin(), ranges.end() );
+
+   set.m_statistics.ranges_inserted = input_count;
+   set.m_statistics.merges = input_count - set.m_ranges.size();
+
+   return set;
+}
+
+
+Coalescing_IP_Range_Set Coalescing_IP_Range_Set::from_coalesced( const std::vector<IP_Range> & contiguous_ranges,
+                                                                  const std::vector<IP_Range> & noncontiguous_ranges )
+{
+   // Contiguous ranges go first on equal keys, as sort_and_coalesce() leaves
+   // them, so they are the ones kept.
+   std::vector<IP_Range> ranges;
+   ranges.reserve( contiguous_ranges.size() + noncontiguous_ranges.size() );
+
+   std::merge( contiguous_ranges.begin(), contiguous_ranges.end(),
+               noncontiguous_ranges.begin(), noncontiguous_ranges.end(),
+               std::back_inserter( ranges ) );
+
+   Coalescing_IP_Range_Set set;
+   set.m_ranges = IP_Range_Set( ranges.begin(), ranges.end() );
+
+   return set;
+}
+
+
 void Coalescing_IP_Range_Set::insert( const IP_Range & range )
 {
-   bool incorporated_via_coalescing = false;
+   m_statistics.ranges_inserted++;
+
+   if( !range.has_contiguous_subnet_mask() )
+   {
+      if( !m_ranges.insert( range ).second )
+      {
+         m_statistics.merges++;
+      }
+      return;
+   }
+
+   IP_Range coalesced_range = range;
 
-   for( auto iter = m_ranges.begin();
-        iter != m_ranges.end();
-        iter++ )
+   // Stored ranges with contiguous masks are disjoint and non-adjacent, so at
+   // most one of those sorting before the new range can reach it.
+   auto iter = m_ranges.lower_bound( range );
+
+   for( auto prev = iter; prev != m_ranges.begin(); )
    {
-      const IP_Range & existing_range = *iter;
+      --prev;
 
-      if( existing_range.is_coalescable( range ) )
+      if( prev->has_contiguous_subnet_mask() )
+      {
+         if( is_mutually_coalescable( *prev, coalesced_range ) )
+         {
+            iter = prev;
+         }
+         break;
+      }
+   }
+
+   while( (iter != m_ranges.end()) &&
+          (iter->get_start_address() <= static_cast<uint64_t>(coalesced_range.get_end_address()) + 1) )
+   {
+      if( is_mutually_coalescable( *iter, coalesced_range ) )
+      {
+         coalesced_range = coalesce( *iter, coalesced_range );
+         iter = m_ranges.erase( iter );
+         m_statistics.merges++;
+      }
+      else
+      {
+         iter++;
+      }
+   }
+
+   store_contiguous( iter, coalesced_range );
+}
+
+
+void Coalescing_IP_Range_Set::erase( const IP_Range & range )
+{
+   if( !range.has_contiguous_subnet_mask() )
+   {
+      auto iter = m_ranges.find( range );
+
+      if( (iter != m_ranges.end()) && !iter->has_contiguous_subnet_mask() )
       {
-         IP_Range coalesced_range = existing_range + range;
          m_ranges.erase( iter );
-         m_ranges.insert( coalesced_range );
+      }
+      return;
+   }
+
+   const uint32_t start_address = range.get_start_address();
+   const uint32_t end_address = range.get_end_address();
 
-         incorporated_via_coalescing = true;
+   // Of the stored ranges with contiguous masks starting at or before the
+   // erased range, only the last can reach into it.
+   auto iter = m_ranges.upper_bound( IP_Range::from_start_and_end_addresses( start_address, 0xffffffff ) );
+
+   for( auto prev = iter; prev != m_ranges.begin(); )
+   {
+      --prev;
 
-         Coalescing_IP_Range_Set recoalesced_set;
-         for( const IP_Range & range : m_ranges )
+      if( prev->has_contiguous_subnet_mask() )
+      {
+         if( prev->get_end_address() >= start_address )
          {
-            recoalesced_set.insert( range );
+            iter = prev;
          }
-         *this = recoalesced_set;
+         break;
+      }
+   }
 
+   while( (iter != m_ranges.end()) && (iter->get_start_address() <= end_address) )
+   {
+      if( !iter->has_contiguous_subnet_mask() )
+      {
+         iter++;
+         continue;
+      }
+
+      if( iter->get_end_address() > end_address )
+      {
+         erase_addresses( iter, start_address, end_address );
          break;
       }
+
+      iter = erase_addresses( iter, start_address, end_address );
    }
+}
+
+
+void Coalescing_IP_Range_Set::erase( uint32_t address )
+{
+   auto iter = find( address );
+
+   if( iter == m_ranges.end() ) return;
 
-   if( !incorporated_via_coalescing )
+   erase_addresses( iter, address, address );
+}
+
+
+IP_Range_Set::iterator Coalescing_IP_Range_Set::erase_addresses( IP_Range_Set::iterator iter,
+                                                                  uint32_t start_address, uint32_t end_address )
+{
+   const IP_Range stored_range = *iter;
+   iter = m_ranges.erase( iter );
+
+   if( stored_range.get_start_address() < start_address )
    {
-      m_ranges.insert( range );
+      iter = store_contiguous( iter, IP_Range::from_start_and_end_addresses( stored_range.get_start_address(), start_address - 1 ) );
    }
+
+   if( stored_range.get_end_address() > end_address )
+   {
+      iter = store_contiguous( iter, IP_Range::from_start_and_end_addresses( end_address + 1, stored_range.get_end_address() ) );
+   }
+
+   return iter;
+}
+
+
+IP_Range_Set::iterator Coalescing_IP_Range_Set::store_contiguous( IP_Range_Set::iterator hint, const IP_Range & range )
+{
+   auto iter = m_ranges.insert( hint, range );
+
+   if( !iter->has_contiguous_subnet_mask() )
+   {
+      iter = m_ranges.erase( iter );
+      iter = m_ranges.insert( iter, range );
+   }
+
+   return std::next( iter );
+}
+
+
+const Coalescing_IP_Range_Set::Statistics & Coalescing_IP_Range_Set::get_statistics() const
+{
+   return m_statistics;
 }
 
 
@@ -78,5 +426,126 @@ int Coalescing_IP_Range_Set::size() const
   return m_ranges.size();
 }
 
+
+IP_Range_Set::const_iterator Coalescing_IP_Range_Set::find( uint32_t address ) const
+{
+   // The only range that can hold address is the last one with a contiguous
+   // mask starting at or before it.
+   auto iter = m_ranges.upper_bound( IP_Range::from_start_and_end_addresses( address, 0xffffffff ) );
+
+   while( iter != m_ranges.begin() )
+   {
+      --iter;
+
+      if( iter->has_contiguous_subnet_mask() )
+      {
+         return (address <= iter->get_end_address()) ? iter : m_ranges.end();
+      }
+   }
+
+   return m_ranges.end();
+}
+
+
+bool Coalescing_IP_Range_Set::contains( uint32_t address ) const
+{
+   return find( address ) != m_ranges.end();
+}
+
+
+bool Coalescing_IP_Range_Set::contains( const IP_Range & range ) const
+{
+   if( !range.has_contiguous_subnet_mask() ) return false;
+
+   // Stored ranges are coalesced, so a range in the set lies within one.
+   auto iter = find( range.get_start_address() );
+
+   return (iter != m_ranges.end()) && (range.get_end_address() <= iter->get_end_address());
+}
+
+
+void Coalescing_IP_Range_Set::contains( const std::vector<uint32_t> & sorted_addresses, std::vector<bool> & results ) const
+{
+   results.assign( sorted_addresses.size(), false );
+
+   auto iter = m_ranges.begin();
+
+   for( std::size_t i = 0; i < sorted_addresses.size(); i++ )
+   {
+      const uint32_t address = sorted_addresses[i];
+
+      while( (iter != m_ranges.end()) &&
+             (!iter->has_contiguous_subnet_mask() || (iter->get_end_address() < address)) )
+      {
+         iter++;
+      }
+
+      if( iter == m_ranges.end() ) break;
+
+      results[i] = (iter->get_start_address() <= address);
+   }
+}
+
+
+
+Coalescing_IP_Range_Set set_union( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b )
+{
+   std::vector<IP_Range> a_contiguous, a_noncontiguous, b_contiguous, b_noncontiguous;
+   split_by_subnet_mask( a, a_contiguous, a_noncontiguous );
+   split_by_subnet_mask( b, b_contiguous, b_noncontiguous );
+
+   std::vector<IP_Range> contiguous, noncontiguous;
+   append_union( a_contiguous, b_contiguous, contiguous );
+   std::set_union( a_noncontiguous.begin(), a_noncontiguous.end(),
+                   b_noncontiguous.begin(), b_noncontiguous.end(),
+                   std::back_inserter( noncontiguous ) );
+
+   return Coalescing_IP_Range_Set::from_coalesced( contiguous, noncontiguous );
+}
+
+
+Coalescing_IP_Range_Set set_intersection( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b )
+{
+   std::vector<IP_Range> a_contiguous, a_noncontiguous, b_contiguous, b_noncontiguous;
+   split_by_subnet_mask( a, a_contiguous, a_noncontiguous );
+   split_by_subnet_mask( b, b_contiguous, b_noncontiguous );
+
+   std::vector<IP_Range> contiguous, noncontiguous;
+   append_intersection( a_contiguous, b_contiguous, contiguous );
+   std::set_intersection( a_noncontiguous.begin(), a_noncontiguous.end(),
+                          b_noncontiguous.begin(), b_noncontiguous.end(),
+                          std::back_inserter( noncontiguous ) );
+
+   return Coalescing_IP_Range_Set::from_coalesced( contiguous, noncontiguous );
+}
+
+
+Coalescing_IP_Range_Set set_difference( const Coalescing_IP_Range_Set & a, const Coalescing_IP_Range_Set & b )
+{
+   std::vector<IP_Range> a_contiguous, a_noncontiguous, b_contiguous, b_noncontiguous;
+   split_by_subnet_mask( a, a_contiguous, a_noncontiguous );
+   split_by_subnet_mask( b, b_contiguous, b_noncontiguous );
+
+   std::vector<IP_Range> contiguous, noncontiguous;
+   append_difference( a_contiguous, b_contiguous, contiguous );
+   std::set_difference( a_noncontiguous.begin(), a_noncontiguous.end(),
+                        b_noncontiguous.begin(), b_noncontiguous.end(),
+                        std::back_inserter( noncontiguous ) );
+
+   return Coalescing_IP_Range_Set::from_coalesced( contiguous, noncontiguous );
+}
+
+
+Coalescing_IP_Range_Set complement( const Coalescing_IP_Range_Set & a )
+{
+   std::vector<IP_Range> a_contiguous, a_noncontiguous;
+   split_by_subnet_mask( a, a_contiguous, a_noncontiguous );
+
+   std::vector<IP_Range> contiguous;
+   append_complement( a_contiguous, contiguous );
+
+   return Coalescing_IP_Range_Set::from_coalesced( contiguous, {} );
+}
+
 } // namespace ip_coalesce
 } // namespace cfeyer
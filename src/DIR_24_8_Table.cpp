@@ -0,0 +1,121 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include <cfeyer/ip_coalesce/DIR_24_8_Table.h>
+
+#include <algorithm>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+DIR_24_8_Table DIR_24_8_Table::build( const Coalescing_IP_Range_Set & set )
+{
+   DIR_24_8_Table table;
+   table.m_first_level.assign( std::size_t( 1 ) << 24, absent_entry );
+
+   for( const IP_Range & range : set )
+   {
+      if( range.has_contiguous_subnet_mask() )
+      {
+         table.add( range.get_start_address(), range.get_end_address() );
+      }
+   }
+
+   return table;
+}
+
+
+std::size_t DIR_24_8_Table::chunk_count() const
+{
+   return m_chunks.size();
+}
+
+
+std::size_t DIR_24_8_Table::memory_bytes() const
+{
+   return (m_first_level.capacity() * sizeof(uint32_t)) + (m_chunks.capacity() * sizeof(Chunk));
+}
+
+
+void DIR_24_8_Table::add( uint32_t start_address, uint32_t end_address )
+{
+   uint32_t first_slash_24 = start_address >> 8;
+   uint32_t last_slash_24 = end_address >> 8;
+
+   if( first_slash_24 == last_slash_24 )
+   {
+      add_within_slash_24( start_address, end_address );
+      return;
+   }
+
+   // Partly covered /24s at either end get chunks; those in between are
+   // covered whole.
+   if( (start_address & 0xff) != 0 )
+   {
+      add_within_slash_24( start_address, start_address | 0xff );
+      first_slash_24++;
+   }
+
+   if( (end_address & 0xff) != 0xff )
+   {
+      add_within_slash_24( end_address & ~0xffu, end_address );
+      last_slash_24--;
+   }
+
+   if( first_slash_24 <= last_slash_24 )
+   {
+      std::fill( m_first_level.begin() + first_slash_24,
+                 m_first_level.begin() + last_slash_24 + 1,
+                 present_entry );
+   }
+}
+
+
+void DIR_24_8_Table::add_within_slash_24( uint32_t start_address, uint32_t end_address )
+{
+   uint32_t & entry = m_first_level[start_address >> 8];
+
+   if( ((start_address & 0xff) == 0) && ((end_address & 0xff) == 0xff) )
+   {
+      entry = present_entry;
+      return;
+   }
+
+   // Ranges arrive in order, so a /24 shared by several ranges already has
+   // its chunk from the first of them.
+   if( entry < first_chunk_entry )
+   {
+      entry = first_chunk_entry + m_chunks.size();
+      m_chunks.push_back( Chunk{ { 0, 0, 0, 0 } } );
+   }
+
+   Chunk & chunk = m_chunks[entry - first_chunk_entry];
+
+   for( uint32_t host = start_address & 0xff; host <= (end_address & 0xff); host++ )
+   {
+      chunk.bits[host >> 6] |= uint64_t( 1 ) << (host & 63);
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
@@ -0,0 +1,496 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "External_Coalescer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+static_assert( std::is_trivially_copyable<IP_Range>::value,
+               "Run files hold IP_Range objects as raw bytes." );
+
+constexpr std::size_t min_chunk_capacity = 1024;
+constexpr std::size_t min_pending_capacity = 64;
+constexpr std::size_t min_input_chunk_size = 4096;
+constexpr std::size_t min_run_buffer_bytes = 64 * 1024;
+
+
+// Order of ranges in sort_and_coalesce() output: ascending, and where a range
+// with a contiguous mask and one without have equal bounds, contiguous first.
+bool sorts_before( const IP_Range & a, const IP_Range & b )
+{
+   if( a < b ) return true;
+   if( b < a ) return false;
+
+   return a.has_contiguous_subnet_mask() && !b.has_contiguous_subnet_mask();
+}
+
+
+} // namespace
+
+
+// Unnamed temporary file holding one sorted, coalesced run of ranges.
+class External_Coalescer::Run_File
+{
+   public:
+
+      explicit Run_File( int level ) :
+         m_level( level ),
+         m_fd( -1 ),
+         m_buffer_position( 0 )
+      {
+         const char * tmpdir = std::getenv( "TMPDIR" );
+         std::string path = std::string( (tmpdir && *tmpdir) ? tmpdir : "/tmp" ) + "/ip-coalesce-run-XXXXXX";
+
+         m_fd = ::mkstemp( &path[0] );
+
+         if( m_fd < 0 )
+         {
+            throw std::system_error( errno, std::generic_category(), "Failed to create run file '" + path + "'" );
+         }
+
+         ::unlink( path.c_str() );
+      }
+
+      ~Run_File()
+      {
+         ::close( m_fd );
+      }
+
+      // Zero for a spilled chunk, one more than the highest of those merged
+      // into it otherwise.
+      int level() const
+      {
+         return m_level;
+      }
+
+      void append( const IP_Range * ranges, std::size_t count )
+      {
+         const char * bytes = reinterpret_cast<const char *>(ranges);
+         std::size_t remaining = count * sizeof(IP_Range);
+
+         while( remaining > 0 )
+         {
+            ssize_t written = ::write( m_fd, bytes, remaining );
+
+            if( written < 0 )
+            {
+               if( errno == EINTR ) continue;
+               throw std::system_error( errno, std::generic_category(), "Failed to write run file" );
+            }
+
+            bytes += written;
+            remaining -= written;
+         }
+      }
+
+      void start_reading( std::size_t buffer_bytes )
+      {
+         if( ::lseek( m_fd, 0, SEEK_SET ) < 0 )
+         {
+            throw std::system_error( errno, std::generic_category(), "Failed to rewind run file" );
+         }
+
+         m_buffer.resize( std::max<std::size_t>( 1, buffer_bytes / sizeof(IP_Range) ) );
+         m_buffer.shrink_to_fit();
+         m_buffer.clear();
+         m_buffer_position = 0;
+      }
+
+      bool next( IP_Range & range )
+      {
+         if( (m_buffer_position == m_buffer.size()) && !refill() ) return false;
+
+         range = m_buffer[m_buffer_position++];
+         return true;
+      }
+
+   private:
+
+      bool refill()
+      {
+         m_buffer.resize( m_buffer.capacity() );
+
+         char * bytes = reinterpret_cast<char *>(m_buffer.data());
+         std::size_t filled = 0;
+         std::size_t wanted = m_buffer.size() * sizeof(IP_Range);
+
+         while( filled < wanted )
+         {
+            ssize_t count = ::read( m_fd, bytes + filled, wanted - filled );
+
+            if( count < 0 )
+            {
+               if( errno == EINTR ) continue;
+               throw std::system_error( errno, std::generic_category(), "Failed to read run file" );
+            }
+
+            if( count == 0 ) break;
+
+            filled += count;
+         }
+
+         m_buffer.resize( filled / sizeof(IP_Range) );
+         m_buffer_position = 0;
+
+         return !m_buffer.empty();
+      }
+
+      int m_level;
+      int m_fd;
+      std::vector<IP_Range> m_buffer;
+      std::size_t m_buffer_position;
+};
+
+
+// Takes ranges in sorts_before() order and coalesces them as
+// sort_and_coalesce() would, passing each finished range to emit.  The final
+// pass also drops ranges with the same bounds as the one before, as inserting
+// into an IP_Range_Set does; earlier passes must keep them, since the first
+// of the pair may still grow.  Ranges with non-contiguous masks that must
+// wait for the current range are held in memory up to pending_capacity at a
+// time, and spilled to a run file beyond that.
+class External_Coalescer::Sorted_Range_Coalescer
+{
+   public:
+
+      Sorted_Range_Coalescer( const std::function<void( const IP_Range & )> & emit, bool drop_duplicates,
+                              std::size_t pending_capacity ) :
+         m_emit( emit ),
+         m_drop_duplicates( drop_duplicates ),
+         m_has_current( false ),
+         m_pending_capacity( pending_capacity ),
+         m_has_emitted( false )
+      {
+      }
+
+      void push( const IP_Range & range )
+      {
+         if( !range.has_contiguous_subnet_mask() )
+         {
+            if( m_has_current )
+            {
+               hold( range );
+            }
+            else
+            {
+               emit( range );
+            }
+         }
+         else if( m_has_current &&
+                  (range.get_start_address() <= static_cast<uint64_t>(m_current.get_end_address()) + 1) )
+         {
+            m_current += range;
+         }
+         else
+         {
+            flush();
+            m_current = range;
+            m_has_current = true;
+         }
+      }
+
+      void flush()
+      {
+         if( !m_has_current ) return;
+
+         // Ranges with non-contiguous masks seen while the current range was
+         // growing start no earlier than it does, but may still sort before it.
+         // They were held in order, the spilled ones first.
+         bool is_current_emitted = false;
+
+         auto emit_held = [&]( const IP_Range & range )
+         {
+            if( !is_current_emitted && !(range < m_current) )
+            {
+               emit( m_current );
+               is_current_emitted = true;
+            }
+
+            emit( range );
+         };
+
+         if( m_pending_run )
+         {
+            IP_Range range;
+            m_pending_run->start_reading( m_pending_capacity * sizeof(IP_Range) );
+
+            while( m_pending_run->next( range ) )
+            {
+               emit_held( range );
+            }
+
+            m_pending_run.reset();
+         }
+
+         for( const IP_Range & range : m_pending_noncontiguous )
+         {
+            emit_held( range );
+         }
+
+         if( !is_current_emitted )
+         {
+            emit( m_current );
+         }
+
+         m_pending_noncontiguous.clear();
+         m_has_current = false;
+      }
+
+   private:
+
+      void hold( const IP_Range & range )
+      {
+         if( m_pending_noncontiguous.capacity() < m_pending_capacity )
+         {
+            m_pending_noncontiguous.reserve( m_pending_capacity );
+         }
+
+         m_pending_noncontiguous.push_back( range );
+
+         if( m_pending_noncontiguous.size() == m_pending_capacity )
+         {
+            if( !m_pending_run )
+            {
+               m_pending_run.reset( new Run_File( 0 ) );
+            }
+
+            m_pending_run->append( m_pending_noncontiguous.data(), m_pending_noncontiguous.size() );
+            m_pending_noncontiguous.clear();
+         }
+      }
+
+      void emit( const IP_Range & range )
+      {
+         if( m_drop_duplicates && m_has_emitted && (range == m_last_emitted) ) return;
+
+         m_emit( range );
+         m_last_emitted = range;
+         m_has_emitted = true;
+      }
+
+      const std::function<void( const IP_Range & )> & m_emit;
+      const bool m_drop_duplicates;
+
+      bool m_has_current;
+      IP_Range m_current;
+      const std::size_t m_pending_capacity;
+      std::vector<IP_Range> m_pending_noncontiguous;
+      std::unique_ptr<Run_File> m_pending_run;
+
+      bool m_has_emitted;
+      IP_Range m_last_emitted;
+};
+
+
+External_Coalescer::External_Coalescer( std::size_t max_memory_bytes, unsigned thread_count ) :
+   m_max_memory_bytes( max_memory_bytes ),
+   m_thread_count( thread_count ),
+   // Every run being merged needs its own read buffer from half the budget.
+   m_max_fan_in( std::max<std::size_t>( 2, max_memory_bytes / 2 / min_run_buffer_bytes ) ),
+   // Held non-contiguous ranges, and the buffer reading back those spilled,
+   // fit in what the chunk and the merge buffers leave.
+   m_pending_capacity( std::max( min_pending_capacity, max_memory_bytes / 16 / sizeof(IP_Range) ) ),
+   // Sorting and coalescing may need a scratch buffer as large as the chunk
+   // itself, so a chunk gets a third of the budget.
+   m_chunk_capacity( std::max( min_chunk_capacity, max_memory_bytes / 3 / sizeof(IP_Range) ) )
+{
+   // Up to max_fan_in - 1 runs of each level stay open, so leave most
+   // descriptors free even with several levels.
+   rlimit limit;
+   if( (::getrlimit( RLIMIT_NOFILE, &limit ) == 0) && (limit.rlim_cur != RLIM_INFINITY) )
+   {
+      m_max_fan_in = std::min<std::size_t>( m_max_fan_in, std::max<rlim_t>( 2, limit.rlim_cur / 16 ) );
+   }
+
+   m_chunk.reserve( m_chunk_capacity );
+}
+
+
+External_Coalescer::~External_Coalescer() = default;
+
+
+std::size_t External_Coalescer::input_chunk_size() const
+{
+   return std::max( min_input_chunk_size, m_max_memory_bytes / 16 );
+}
+
+
+int External_Coalescer::run_count() const
+{
+   return m_runs.size();
+}
+
+
+void External_Coalescer::insert( const IP_Range & range )
+{
+   m_chunk.push_back( range );
+
+   if( m_chunk.size() == m_chunk_capacity )
+   {
+      spill_chunk();
+   }
+}
+
+
+void External_Coalescer::spill_chunk()
+{
+   sort_and_coalesce( m_chunk, m_thread_count );
+
+   m_runs.emplace_back( new Run_File( 0 ) );
+   m_runs.back()->append( m_chunk.data(), m_chunk.size() );
+
+   m_chunk.clear();
+
+   // Runs are appended in order of falling level, so a full level is the
+   // last max_fan_in runs, and merging it may fill the next.
+   while( m_runs.size() >= m_max_fan_in )
+   {
+      const int level = m_runs.back()->level();
+      const std::size_t first = m_runs.size() - m_max_fan_in;
+
+      if( m_runs[first]->level() != level ) break;
+
+      merge_last_runs( m_max_fan_in );
+   }
+}
+
+
+void External_Coalescer::merge_last_runs( std::size_t count )
+{
+   const std::size_t first = m_runs.size() - count;
+
+   int level = 0;
+   for( std::size_t i = first; i < m_runs.size(); i++ )
+   {
+      level = std::max( level, m_runs[i]->level() + 1 );
+   }
+
+   // The output buffer takes the same share of the merge budget as each run.
+   std::unique_ptr<Run_File> merged_run( new Run_File( level ) );
+   std::vector<IP_Range> output;
+   const std::size_t output_capacity = std::max<std::size_t>( 1, m_max_memory_bytes / 2 / (count + 1) / sizeof(IP_Range) );
+   output.reserve( output_capacity );
+
+   merge_runs( first, m_runs.size(), false, [&]( const IP_Range & range ) {
+      output.push_back( range );
+      if( output.size() == output_capacity )
+      {
+         merged_run->append( output.data(), output.size() );
+         output.clear();
+      }
+   } );
+
+   merged_run->append( output.data(), output.size() );
+
+   m_runs.erase( m_runs.begin() + first, m_runs.end() );
+   m_runs.push_back( std::move(merged_run) );
+}
+
+
+void External_Coalescer::merge_runs( std::size_t first, std::size_t last, bool is_final_pass,
+                                     const std::function<void( const IP_Range & )> & emit )
+{
+   using Head = std::pair<IP_Range, std::size_t>;
+   auto greater = []( const Head & a, const Head & b ) { return sorts_before( b.first, a.first ); };
+   std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads( greater );
+
+   const std::size_t buffer_bytes = m_max_memory_bytes / 2 / (last - first + 1);
+
+   for( std::size_t i = first; i < last; i++ )
+   {
+      IP_Range range;
+      m_runs[i]->start_reading( buffer_bytes );
+      if( m_runs[i]->next( range ) ) heads.emplace( range, i );
+   }
+
+   Sorted_Range_Coalescer coalescer( emit, is_final_pass, m_pending_capacity );
+
+   while( !heads.empty() )
+   {
+      Head head = heads.top();
+      heads.pop();
+
+      coalescer.push( head.first );
+
+      IP_Range range;
+      if( m_runs[head.second]->next( range ) ) heads.emplace( range, head.second );
+   }
+
+   coalescer.flush();
+}
+
+
+void External_Coalescer::finish( const std::function<void( const IP_Range & )> & emit )
+{
+   if( m_runs.empty() )
+   {
+      sort_and_coalesce( m_chunk, m_thread_count );
+
+      Sorted_Range_Coalescer coalescer( emit, true, m_pending_capacity );
+      for( const IP_Range & range : m_chunk )
+      {
+         coalescer.push( range );
+      }
+      coalescer.flush();
+
+      m_chunk.clear();
+      return;
+   }
+
+   if( !m_chunk.empty() )
+   {
+      spill_chunk();
+   }
+
+   std::vector<IP_Range>().swap( m_chunk );
+
+   // Partly filled levels may still leave more runs than can be merged at
+   // once; merge the smallest first.
+   while( m_runs.size() > m_max_fan_in )
+   {
+      merge_last_runs( m_max_fan_in );
+   }
+
+   merge_runs( 0, m_runs.size(), true, emit );
+
+   m_runs.clear();
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
@@ -0,0 +1,113 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef EXTERNAL_COALESCER_H
+#define EXTERNAL_COALESCER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Coalesces more ranges than fit in memory.  Inserted ranges are gathered
+// into fixed-size chunks; each full chunk is sorted, coalesced and written to
+// a temporary run file, and finish() k-way merges the runs, coalescing across
+// run boundaries as it streams the result out.  Working memory stays within
+// max_memory_bytes however many ranges are inserted.  Runs are merged a level
+// at a time as they are spilled, so that few are open at once: whenever
+// max_fan_in runs of one level exist they become one run of the next.
+class External_Coalescer
+{
+   public:
+
+      explicit External_Coalescer( std::size_t max_memory_bytes, unsigned thread_count = 1 );
+      ~External_Coalescer();
+
+      External_Coalescer( const External_Coalescer & ) = delete;
+      External_Coalescer & operator = ( const External_Coalescer & ) = delete;
+
+      // Bytes of input text to parse at a time so that parsing stays within
+      // the budget too.
+      std::size_t input_chunk_size() const;
+
+      void insert( const IP_Range & range );
+
+      template< typename Input_Iterator >
+      void insert( Input_Iterator first, Input_Iterator last );
+
+      // Passes the coalesced ranges to emit in ascending order.
+      void finish( const std::function<void( const IP_Range & )> & emit );
+
+      // Run files written and not yet merged away, each holding a descriptor.
+      int run_count() const;
+
+   private:
+
+      class Run_File;
+      class Sorted_Range_Coalescer;
+
+      void spill_chunk();
+
+      // Merges the last count runs into one run in their place.
+      void merge_last_runs( std::size_t count );
+
+      // Merges runs[first, last) in sorted order, coalescing them as the final
+      // pass or for another run.
+      void merge_runs( std::size_t first, std::size_t last, bool is_final_pass,
+                       const std::function<void( const IP_Range & )> & emit );
+
+      std::size_t m_max_memory_bytes;
+      unsigned m_thread_count;
+
+      // Runs merged at once, limited by the read buffers the budget allows
+      // and by the descriptors the process may open.
+      std::size_t m_max_fan_in;
+
+      // Non-contiguous ranges held in memory at once while a contiguous range
+      // they may sort after is still growing.
+      std::size_t m_pending_capacity;
+
+      std::vector<IP_Range> m_chunk;
+      std::size_t m_chunk_capacity;
+
+      std::vector<std::unique_ptr<Run_File>> m_runs;
+};
+
+
+template< typename Input_Iterator >
+void External_Coalescer::insert( Input_Iterator first, Input_Iterator last )
+{
+   for( ; first != last; first++ )
+   {
+      insert( *first );
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* EXTERNAL_COALESCER_H */
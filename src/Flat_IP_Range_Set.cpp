@@ -0,0 +1,214 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <cfeyer/ip_coalesce/Flat_IP_Range_Set.h>
+
+#include <algorithm>
+
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+Flat_IP_Range_Set Flat_IP_Range_Set::build( std::vector<IP_Range> && ranges )
+{
+   sort_and_coalesce( ranges );
+
+   Flat_IP_Range_Set set;
+   set.m_start_addresses.reserve( ranges.size() );
+   set.m_end_addresses.reserve( ranges.size() );
+
+   for( const IP_Range & range : ranges )
+   {
+      if( range.has_contiguous_subnet_mask() )
+      {
+         set.m_start_addresses.push_back( range.get_start_address() );
+         set.m_end_addresses.push_back( range.get_end_address() );
+      }
+      else
+      {
+         set.m_noncontiguous_ranges.push_back( range );
+      }
+   }
+
+   set.m_start_addresses.shrink_to_fit();
+   set.m_end_addresses.shrink_to_fit();
+
+   return set;
+}
+
+
+void Flat_IP_Range_Set::insert( const IP_Range & range )
+{
+   if( !range.has_contiguous_subnet_mask() )
+   {
+      auto iter = std::lower_bound( m_noncontiguous_ranges.begin(), m_noncontiguous_ranges.end(), range );
+
+      if( (iter == m_noncontiguous_ranges.end()) || !(*iter == range) )
+      {
+         m_noncontiguous_ranges.insert( iter, range );
+      }
+
+      return;
+   }
+
+   uint32_t start_address = range.get_start_address();
+   uint32_t end_address = range.get_end_address();
+
+   // Stored ranges in [first_index, last_index) overlap or are adjacent to the
+   // new range: they end no earlier than just before its start, and begin no
+   // later than just after its end.
+   std::size_t first_index =
+      std::lower_bound( m_end_addresses.begin(), m_end_addresses.end(),
+                        (start_address > 0) ? (start_address - 1) : 0 ) - m_end_addresses.begin();
+
+   std::size_t last_index =
+      (end_address < 0xffffffff) ?
+         std::upper_bound( m_start_addresses.begin(), m_start_addresses.end(),
+                           end_address + 1 ) - m_start_addresses.begin() :
+         m_start_addresses.size();
+
+   if( first_index < last_index )
+   {
+      m_start_addresses[first_index] = std::min( start_address, m_start_addresses[first_index] );
+      m_end_addresses[first_index] = std::max( end_address, m_end_addresses[last_index - 1] );
+
+      m_start_addresses.erase( m_start_addresses.begin() + first_index + 1,
+                               m_start_addresses.begin() + last_index );
+      m_end_addresses.erase( m_end_addresses.begin() + first_index + 1,
+                             m_end_addresses.begin() + last_index );
+   }
+   else
+   {
+      m_start_addresses.insert( m_start_addresses.begin() + first_index, start_address );
+      m_end_addresses.insert( m_end_addresses.begin() + first_index, end_address );
+   }
+}
+
+
+int Flat_IP_Range_Set::size() const
+{
+   return m_start_addresses.size() + m_noncontiguous_ranges.size();
+}
+
+
+Flat_IP_Range_Set::const_iterator Flat_IP_Range_Set::begin() const
+{
+   return const_iterator( this, 0, 0 );
+}
+
+
+Flat_IP_Range_Set::const_iterator Flat_IP_Range_Set::end() const
+{
+   return const_iterator( this, m_start_addresses.size(), m_noncontiguous_ranges.size() );
+}
+
+
+Flat_IP_Range_Set::const_iterator::const_iterator() :
+   m_set( nullptr ),
+   m_contiguous_index( 0 ),
+   m_noncontiguous_index( 0 )
+{
+}
+
+
+Flat_IP_Range_Set::const_iterator::const_iterator( const Flat_IP_Range_Set * set,
+                                                   std::size_t contiguous_index,
+                                                   std::size_t noncontiguous_index ) :
+   m_set( set ),
+   m_contiguous_index( contiguous_index ),
+   m_noncontiguous_index( noncontiguous_index )
+{
+}
+
+
+bool Flat_IP_Range_Set::const_iterator::is_at_contiguous_range() const
+{
+   if( m_contiguous_index == m_set->m_start_addresses.size() ) return false;
+   if( m_noncontiguous_index == m_set->m_noncontiguous_ranges.size() ) return true;
+
+   IP_Range contiguous_range =
+      IP_Range::from_start_and_end_addresses( m_set->m_start_addresses[m_contiguous_index],
+                                              m_set->m_end_addresses[m_contiguous_index] );
+
+   return !(m_set->m_noncontiguous_ranges[m_noncontiguous_index] < contiguous_range);
+}
+
+
+Flat_IP_Range_Set::const_iterator::reference Flat_IP_Range_Set::const_iterator::operator * () const
+{
+   if( is_at_contiguous_range() )
+   {
+      return IP_Range::from_start_and_end_addresses( m_set->m_start_addresses[m_contiguous_index],
+                                                     m_set->m_end_addresses[m_contiguous_index] );
+   }
+   else
+   {
+      return m_set->m_noncontiguous_ranges[m_noncontiguous_index];
+   }
+}
+
+
+Flat_IP_Range_Set::const_iterator::pointer Flat_IP_Range_Set::const_iterator::operator -> () const
+{
+   return pointer( **this );
+}
+
+
+Flat_IP_Range_Set::const_iterator & Flat_IP_Range_Set::const_iterator::operator ++ ()
+{
+   if( is_at_contiguous_range() )
+   {
+      m_contiguous_index++;
+   }
+   else
+   {
+      m_noncontiguous_index++;
+   }
+
+   return *this;
+}
+
+
+Flat_IP_Range_Set::const_iterator Flat_IP_Range_Set::const_iterator::operator ++ ( int )
+{
+   const_iterator previous = *this;
+   ++(*this);
+   return previous;
+}
+
+
+bool Flat_IP_Range_Set::const_iterator::operator == ( const const_iterator & other ) const
+{
+   return (m_set == other.m_set) &&
+          (m_contiguous_index == other.m_contiguous_index) &&
+          (m_noncontiguous_index == other.m_noncontiguous_index);
+}
+
+
+bool Flat_IP_Range_Set::const_iterator::operator != ( const const_iterator & other ) const
+{
+   return !(*this == other);
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
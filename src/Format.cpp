@@ -22,30 +22,96 @@
 
 #include "Format.h"
 
-#include <sstream>
-#include <vector>
+#include <array>
+#include <utility>
 
 namespace cfeyer {
 namespace ip_coalesce {
 
-std::string to_dotted_octet( uint32_t ip_address )
+namespace {
+
+// Decimal digits of every octet value, so formatting an address is four
+// table lookups instead of repeated division.
+struct Octet_Digits
+{
+   char length;
+   char digits[3];
+};
+
+constexpr Octet_Digits make_octet_digits( int octet )
+{
+   return (octet >= 100) ?
+             Octet_Digits{ 3, { static_cast<char>('0' + (octet / 100)),
+                                static_cast<char>('0' + ((octet / 10) % 10)),
+                                static_cast<char>('0' + (octet % 10)) } } :
+          (octet >= 10) ?
+             Octet_Digits{ 2, { static_cast<char>('0' + (octet / 10)),
+                                static_cast<char>('0' + (octet % 10)),
+                                0 } } :
+             Octet_Digits{ 1, { static_cast<char>('0' + octet), 0, 0 } };
+}
+
+template< std::size_t... Octets >
+constexpr std::array<Octet_Digits, sizeof...(Octets)> make_octet_digits_table( std::index_sequence<Octets...> )
+{
+   return {{ make_octet_digits( Octets )... }};
+}
+
+constexpr std::array<Octet_Digits, 256> octet_digits_table =
+   make_octet_digits_table( std::make_index_sequence<256>() );
+
+
+char * format_octet( char * out, uint32_t octet )
+{
+   const Octet_Digits & entry = octet_digits_table[octet];
+
+   out[0] = entry.digits[0];
+   out[1] = entry.digits[1];
+   out[2] = entry.digits[2];
+
+   return out + entry.length;
+}
+
+} // namespace
+
+
+char * format_dotted_octet( char * out, uint32_t ip_address )
 {
-   std::ostringstream strm;
+   out = format_octet( out, ip_address >> 24 );
+   *out++ = '.';
+   out = format_octet( out, (ip_address >> 16) & 0xff );
+   *out++ = '.';
+   out = format_octet( out, (ip_address >> 8) & 0xff );
+   *out++ = '.';
+   return format_octet( out, ip_address & 0xff );
+}
+
 
-   uint32_t x = ip_address;
+char * format_decimal( char * out, uint32_t value )
+{
+   char digits[10];
+   int length = 0;
 
-   for( int i = 0; i < 4; i++ )
+   do
    {
-      uint32_t high_octet = (x & 0xff000000) >> 24;
-      strm << high_octet;
-      if( i < 3)
-      {
-         strm << ".";
-      }
-      x = x << 8;
+      digits[length++] = static_cast<char>('0' + (value % 10));
+      value /= 10;
    }
+   while( value != 0 );
 
-   return strm.str();
+   while( length > 0 )
+   {
+      *out++ = digits[--length];
+   }
+
+   return out;
+}
+
+
+std::string to_dotted_octet( uint32_t ip_address )
+{
+   char buffer[max_dotted_octet_length];
+   return std::string( buffer, format_dotted_octet( buffer, ip_address ) );
 }
 
 
@@ -23,12 +23,21 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
 namespace cfeyer {
 namespace ip_coalesce {
 
+constexpr std::size_t max_dotted_octet_length = 15;
+
+// Write at out and return one past the last character written.
+// format_dotted_octet() may scribble past the returned position, but never
+// beyond max_dotted_octet_length bytes from out.
+char * format_dotted_octet( char * out, uint32_t ip_address );
+char * format_decimal( char * out, uint32_t value );
+
 std::string to_dotted_octet( uint32_t ip_address );
 
 uint32_t from_octets( uint8_t o3, uint8_t o2, uint8_t o1, uint8_t o0 );
@@ -0,0 +1,308 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include <cfeyer/ip_coalesce/IP6_Range.h>
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Format.h"
+#include "Scan.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+constexpr int group_count = 8;
+
+
+int hex_digit_value( char c )
+{
+   if( static_cast<unsigned char>(c - '0') < 10 ) return c - '0';
+   if( static_cast<unsigned char>(c - 'a') < 6 ) return c - 'a' + 10;
+   if( static_cast<unsigned char>(c - 'A') < 6 ) return c - 'A' + 10;
+   return -1;
+}
+
+
+// Scans a dotted quad into two 16-bit groups.
+bool scan_dotted_quad( const char * & pos, const char * last, uint16_t * groups )
+{
+   uint32_t address = 0;
+   if( !scan_four_octets( pos, last, address ) ) return false;
+
+   groups[0] = static_cast<uint16_t>(address >> 16);
+   groups[1] = static_cast<uint16_t>(address);
+   return true;
+}
+
+
+// Scans one address at pos, stopping at the first character that cannot
+// continue it.
+bool scan_address( const char * & pos, const char * last, IP6_Address & address )
+{
+   uint16_t groups[group_count] = {};
+   int count = 0;
+   int gap = -1;
+
+   if( (last - pos >= 2) && (pos[0] == ':') && (pos[1] == ':') )
+   {
+      gap = 0;
+      pos += 2;
+   }
+
+   while( (pos != last) && (hex_digit_value( *pos ) >= 0) )
+   {
+      if( count == group_count ) return false;
+
+      const char * group_begin = pos;
+      uint32_t value = 0;
+
+      while( (pos != last) && (hex_digit_value( *pos ) >= 0) )
+      {
+         if( pos - group_begin == 4 ) return false;
+         value = (value << 4) | static_cast<uint32_t>(hex_digit_value( *pos ));
+         pos++;
+      }
+
+      if( (pos != last) && (*pos == '.') )
+      {
+         // An embedded IPv4 address ends the address and fills two groups.
+         pos = group_begin;
+         if( (count > group_count - 2) || !scan_dotted_quad( pos, last, groups + count ) ) return false;
+         count += 2;
+         break;
+      }
+
+      groups[count++] = static_cast<uint16_t>(value);
+
+      if( (pos == last) || (*pos != ':') ) break;
+      pos++;
+
+      if( (pos != last) && (*pos == ':') )
+      {
+         if( gap >= 0 ) return false;
+         gap = count;
+         pos++;
+      }
+      else if( (pos == last) || (hex_digit_value( *pos ) < 0) )
+      {
+         // A single ':' must be followed by another group.
+         return false;
+      }
+   }
+
+   if( (gap < 0) ? (count != group_count) : (count > group_count - 1) ) return false;
+
+   // Spread the groups after the gap out to the end.
+   if( gap >= 0 )
+   {
+      int after_gap = count - gap;
+      for( int i = 0; i < after_gap; i++ )
+      {
+         groups[group_count - 1 - i] = groups[count - 1 - i];
+      }
+      for( int i = gap; i < group_count - after_gap; i++ )
+      {
+         groups[i] = 0;
+      }
+   }
+
+   address = 0;
+   for( int i = 0; i < group_count; i++ )
+   {
+      address = (address << 16) | groups[i];
+   }
+
+   return true;
+}
+
+
+char * format_hex_group( char * out, uint16_t group )
+{
+   static constexpr char hex_digits[] = "0123456789abcdef";
+
+   bool is_leading = true;
+   for( int shift = 12; shift >= 0; shift -= 4 )
+   {
+      int digit = (group >> shift) & 0xf;
+      if( is_leading && (digit == 0) && (shift > 0) ) continue;
+      is_leading = false;
+      *out++ = hex_digits[digit];
+   }
+
+   return out;
+}
+
+
+char * format_address( char * out, IP6_Address address )
+{
+   uint16_t groups[group_count];
+   for( int i = 0; i < group_count; i++ )
+   {
+      groups[i] = static_cast<uint16_t>(address >> (16 * (group_count - 1 - i)));
+   }
+
+   // RFC 5952: "::" replaces the longest run of two or more zero groups,
+   // the first such run if there is a tie.
+   int gap_begin = -1;
+   int gap_length = 1;
+
+   for( int i = 0; i < group_count; )
+   {
+      int run_end = i;
+      while( (run_end < group_count) && (groups[run_end] == 0) ) run_end++;
+
+      if( run_end - i > gap_length )
+      {
+         gap_begin = i;
+         gap_length = run_end - i;
+      }
+
+      i = (run_end > i) ? run_end : i + 1;
+   }
+
+   for( int i = 0; i < group_count; i++ )
+   {
+      if( i == gap_begin )
+      {
+         *out++ = ':';
+         *out++ = ':';
+         i += gap_length - 1;
+         continue;
+      }
+
+      if( (i > 0) && (i != gap_begin + gap_length) )
+      {
+         *out++ = ':';
+      }
+
+      out = format_hex_group( out, groups[i] );
+   }
+
+   return out;
+}
+
+} // namespace
+
+
+bool try_parse_ip6_range( std::string_view str, IP6_Range & range )
+{
+   const char * pos = str.data();
+   const char * last = pos + str.size();
+
+   IP6_Address first = 0;
+   if( !scan_address( pos, last, first ) ) return false;
+
+   if( pos == last )
+   {
+      range = IP6_Range::from_start_and_end_addresses( first, first );
+      return true;
+   }
+
+   const char delimiter = *pos++;
+
+   if( delimiter == '/' )
+   {
+      uint32_t prefix_length = 0;
+      if( !scan_decimal( pos, last, 128, prefix_length ) || (pos != last) ) return false;
+
+      range = IP6_Range::from_subnet( first, prefix_length );
+      return true;
+   }
+
+   if( delimiter == '-' )
+   {
+      IP6_Address second = 0;
+      if( !scan_address( pos, last, second ) || (pos != last) || (second < first) ) return false;
+
+      range = IP6_Range::from_start_and_end_addresses( first, second );
+      return true;
+   }
+
+   return false;
+}
+
+
+IP6_Range parse_ip6_range( std::string_view str )
+{
+   IP6_Range range;
+
+   if( !try_parse_ip6_range( str, range ) )
+   {
+      std::ostringstream msg;
+      msg << "Failed to parse '" << str << "'.";
+      throw std::runtime_error( msg.str() );
+   }
+
+   return range;
+}
+
+
+char * format_range( char * out, const IP6_Range & range )
+{
+   out = format_address( out, range.get_start_address() );
+
+   if( range.get_start_address() == range.get_end_address() )
+   {
+      return out;
+   }
+
+   if( range.is_subnet() )
+   {
+      *out++ = '/';
+      return format_decimal( out, range.prefix_length() );
+   }
+
+   *out++ = '-';
+   return format_address( out, range.get_end_address() );
+}
+
+
+char * format_cidr_block( char * out, const IP6_Range & block )
+{
+   out = format_address( out, block.get_start_address() );
+   *out++ = '/';
+   return format_decimal( out, block.prefix_length() );
+}
+
+
+std::string to_string( const IP6_Range & range )
+{
+   char buffer[max_ip6_range_string_length];
+   return std::string( buffer, format_range( buffer, range ) );
+}
+
+
+std::ostream & operator << ( std::ostream & ostrm, const IP6_Range & range )
+{
+   char buffer[max_ip6_range_string_length];
+   ostrm.write( buffer, format_range( buffer, range ) - buffer );
+   return ostrm;
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
@@ -21,18 +21,18 @@
 //  THE SOFTWARE.
 
 #include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/Basic_IP_Range.h>
 
 #include <sstream>
 #include <algorithm>
-#include <vector>
 #include <stdexcept>
-#include <regex>
 #include <string>
 #include <iostream> //TODO debug
 
 #include "Format.h"
 #include "CIDR_Network.h"
 #include "Interval.h"
+#include "Scan.h"
 
 namespace cfeyer {
 namespace ip_coalesce {
@@ -64,6 +64,24 @@ IP_Range::IP_Range() :
 }
 
 
+IP_Range IP_Range::from_start_and_end_addresses( uint32_t start_address, uint32_t end_address )
+{
+   if( end_address < start_address )
+   {
+      std::ostringstream msg;
+      msg << "IP_Range: end_address < start_address "
+          << "(start_address=" << start_address << ", "
+          << "end_address=" << end_address << ")";
+      throw std::logic_error( msg.str() );
+   }
+
+   IP_Range range;
+   range.m_start_address = start_address;
+   range.m_end_address = end_address;
+   return range;
+}
+
+
 uint32_t IP_Range::get_start_address() const
 {
    return m_start_address;
@@ -76,204 +94,181 @@ uint32_t IP_Range::get_end_address() const
 }
 
 
-void IP_Range::from_string( const std::string & str )
-{
-   bool success =
-      from_four_octet_address_slash_four_octet_netmask_string( str ) ||
-      from_four_octet_address_slash_netmask_length_string( str ) ||
-      from_four_octet_address_dash_four_octet_address_string( str ) ||
-      from_four_octet_address_no_netmask_string( str );
+namespace {
 
-   if( !success )
-   {
-      std::ostringstream msg;
-      msg << "Failed to parse '" << str << "'.";
-      throw std::runtime_error( msg.str() );
-   }
-}
+enum class Range_Syntax
+{
+   four_octet_address_no_netmask,
+   four_octet_address_slash_netmask_length,
+   four_octet_address_slash_four_octet_netmask,
+   four_octet_address_dash_four_octet_address,
+   invalid
+};
+
+
+// Single pass over str recognizing every syntax from_string() accepts.  On
+// success, first holds the leading address and second holds the netmask
+// length, netmask or end address, according to the syntax returned.
+Range_Syntax scan_range( std::string_view str, uint32_t & first, uint32_t & second )
+{
+   const char * pos = str.data();
+   const char * last = pos + str.size();
 
+   if( !scan_four_octets( pos, last, first ) ) return Range_Syntax::invalid;
 
-bool IP_Range:: from_four_octet_address_slash_four_octet_netmask_string( const std::string & str )
-{
-   bool success = false;
+   if( pos == last ) return Range_Syntax::four_octet_address_no_netmask;
 
-   std::smatch matches;
-   static const std::regex regex( "([0-9]+)\\.([0-9]+)\\.([0-9]+)\\.([0-9]+)/([0-9]+)\\.([0-9]+)\\.([0-9]+)\\.([0-9]+)" );
+   const char delimiter = *pos++;
+   const char * after_delimiter = pos;
 
-   if( std::regex_match( str, matches, regex ) )
+   if( delimiter == '-' )
    {
-      std::vector<std::uint8_t> octets(8);
-
-      for( int i = 1; i < matches.size(); i++ )
+      // As for IPv6, the end address may not precede the start.
+      if( scan_four_octets( pos, last, second ) && (pos == last) && (second >= first) )
       {
-         const std::string & octet_str = matches[i];
-         uint8_t octet = std::stoi( octet_str );
-         octets.at(i-1) = octet;
+         return Range_Syntax::four_octet_address_dash_four_octet_address;
+      }
+   }
+   else if( delimiter == '/' )
+   {
+      if( scan_four_octets( pos, last, second ) && (pos == last) )
+      {
+         return Range_Syntax::four_octet_address_slash_four_octet_netmask;
       }
 
-      *this = IP_Range( from_octets(octets.at(0), octets.at(1), octets.at(2), octets.at(3) ),
-                        from_octets(octets.at(4), octets.at(5), octets.at(6), octets.at(7) ) );
+      pos = after_delimiter;
 
-      success = true;
+      if( scan_decimal( pos, last, 32, second ) && (pos == last) )
+      {
+         return Range_Syntax::four_octet_address_slash_netmask_length;
+      }
    }
 
-   return success;
+   return Range_Syntax::invalid;
 }
 
 
-bool IP_Range:: from_four_octet_address_slash_netmask_length_string( const std::string & str )
+bool make_range( Range_Syntax syntax, uint32_t first, uint32_t second, IP_Range & range )
 {
-   bool success = false;
-
-   std::smatch matches;
-   static const std::regex regex( "([0-9]+)\\.([0-9]+)\\.([0-9]+)\\.([0-9]+)/([0-9]+)" );
-
-   if( std::regex_match( str, matches, regex ) )
+   switch( syntax )
    {
-      std::vector<std::uint8_t> octets(4);
+      case Range_Syntax::four_octet_address_no_netmask:
+         range = IP_Range( first, 0xffffffff );
+         return true;
 
-      for( int i = 1; i < (matches.size()-1); i++ )
-      {
-         const std::string & octet_str = matches[i];
-         uint8_t octet = std::stoi( octet_str );
-         octets.at(i-1) = octet;
-      }
+      case Range_Syntax::four_octet_address_slash_netmask_length:
+         range = IP_Range( first, size_to_subnet_mask( netmask_length_to_address_count( second ) ) );
+         return true;
 
-      int netmask_length = std::stoi( matches[matches.size()-1] );
+      case Range_Syntax::four_octet_address_slash_four_octet_netmask:
+         range = IP_Range( first, second );
+         return true;
 
-      *this = IP_Range( from_octets(octets.at(0), octets.at(1), octets.at(2), octets.at(3) ),
-                        size_to_subnet_mask( netmask_length_to_address_count( netmask_length ) ) );
+      case Range_Syntax::four_octet_address_dash_four_octet_address:
+         range = IP_Range::from_start_and_end_addresses( first, second );
+         return true;
 
-      success = true;
+      default:
+         return false;
    }
-
-   return success;
 }
 
 
-bool IP_Range:: from_four_octet_address_no_netmask_string( const std::string & str )
+// Parses str into range only if it is written in the given syntax.
+bool parse_range( std::string_view str, Range_Syntax syntax, IP_Range & range )
 {
-   bool success = false;
+   uint32_t first = 0;
+   uint32_t second = 0;
+
+   return (scan_range( str, first, second ) == syntax) &&
+          make_range( syntax, first, second, range );
+}
+
+} // namespace
 
-   std::smatch matches;
-   static const std::regex regex( "([0-9]+)\\.([0-9]+)\\.([0-9]+)\\.([0-9]+)" );
 
-   if( std::regex_match( str, matches, regex ) )
+void IP_Range::from_string( std::string_view str )
+{
+   if( !try_from_string( str ) )
    {
-      std::vector<std::uint8_t> octets(4);
+      std::ostringstream msg;
+      msg << "Failed to parse '" << str << "'.";
+      throw std::runtime_error( msg.str() );
+   }
+}
 
-      for( int i = 1; i < matches.size(); i++ )
-      {
-         const std::string & octet_str = matches[i];
-         uint8_t octet = std::stoi( octet_str );
-         octets.at(i-1) = octet;
-      }
 
-      *this = IP_Range( from_octets(octets.at(0), octets.at(1), octets.at(2), octets.at(3) ),
-                        0xffffffff );
+bool IP_Range::try_from_string( std::string_view str )
+{
+   uint32_t first = 0;
+   uint32_t second = 0;
 
-       success = true;
-   }
+   Range_Syntax syntax = scan_range( str, first, second );
 
-   return success;
+   return make_range( syntax, first, second, *this );
 }
 
 
-bool IP_Range:: from_four_octet_address_dash_four_octet_address_string( const std::string & str )
+bool IP_Range::from_four_octet_address_slash_four_octet_netmask_string( std::string_view str )
 {
-   bool success = false;
+   return parse_range( str, Range_Syntax::four_octet_address_slash_four_octet_netmask, *this );
+}
 
-   std::smatch matches;
-   static const std::regex regex( "([0-9]+)\\.([0-9]+)\\.([0-9]+)\\.([0-9]+)-([0-9]+)\\.([0-9]+)\\.([0-9]+)\\.([0-9]+)" );
 
-   if( std::regex_match( str, matches, regex ) )
-   {
-      std::vector<std::uint8_t> octets(8);
+bool IP_Range::from_four_octet_address_slash_netmask_length_string( std::string_view str )
+{
+   return parse_range( str, Range_Syntax::four_octet_address_slash_netmask_length, *this );
+}
 
-      for( int i = 1; i < matches.size(); i++ )
-      {
-         const std::string & octet_str = matches[i];
-         uint8_t octet = std::stoi( octet_str );
-         octets.at(i-1) = octet;
-      }
 
-      *this = IP_Range();
-      m_start_address = from_octets( octets.at(0), octets.at(1), octets.at(2), octets.at(3) );
-      m_end_address = from_octets( octets.at(4), octets.at(5), octets.at(6), octets.at(7) );
+bool IP_Range::from_four_octet_address_no_netmask_string( std::string_view str )
+{
+   return parse_range( str, Range_Syntax::four_octet_address_no_netmask, *this );
+}
 
-      success = true;
-   }
 
-   return success;
+bool IP_Range::from_four_octet_address_dash_four_octet_address_string( std::string_view str )
+{
+   return parse_range( str, Range_Syntax::four_octet_address_dash_four_octet_address, *this );
 }
 
 
 std::string IP_Range::to_string() const
 {
-   std::string str;
-
-   if( !m_noncontiguous_subnet_mask )
-   {
-      if( (size() > 1) && is_subnet() )
-      {
-         str = to_cidr();
-      }
-      else
-      {
-         str = to_start_dash_end();
-      }
-   }
-   else
-   {
-      str = to_start_slash_subnet_mask();
-   }
-
-   return str;
+   char buffer[max_string_length];
+   return std::string( buffer, format_range( buffer, *this ) );
 }
 
 
-std::string IP_Range::to_start_dash_end() const
+char * IP_Range::format_start_dash_end( char * out ) const
 {
-   std::string str;
+   out = format_dotted_octet( out, m_start_address );
 
-   if( m_start_address == m_end_address )
+   if( m_start_address != m_end_address )
    {
-      str = to_dotted_octet( m_start_address );
-   }
-   else
-   {
-      std::ostringstream strm;
-      strm << to_dotted_octet( m_start_address )
-           << "-"
-           << to_dotted_octet( m_end_address );
-      str = strm.str();
+      *out++ = '-';
+      out = format_dotted_octet( out, m_end_address );
    }
 
-   return str;
+   return out;
 }
 
 
-std::string IP_Range::to_start_slash_subnet_mask() const
+char * IP_Range::format_start_slash_subnet_mask( char * out ) const
 {
    if( !m_noncontiguous_subnet_mask ) throw std::logic_error("Subnet mask not available");
 
-   std::ostringstream strm;
-
-   strm << to_dotted_octet( m_start_address ) << "/"
-        << to_dotted_octet( m_noncontiguous_subnet_mask );
-
-   return strm.str();
+   out = format_dotted_octet( out, m_start_address );
+   *out++ = '/';
+   return format_dotted_octet( out, m_noncontiguous_subnet_mask );
 }
 
 
-std::string IP_Range::to_cidr() const
+char * IP_Range::format_cidr( char * out ) const
 {
-   std::ostringstream strm;
-
-   strm << to_dotted_octet( m_start_address ) << "/"
-        << (32 - ::cfeyer::ip_coalesce::log_base_2(size()) );
-
-   return strm.str();
+   out = format_dotted_octet( out, m_start_address );
+   *out++ = '/';
+   return format_decimal( out, 32 - ::cfeyer::ip_coalesce::log_base_2(size()) );
 }
 
 
@@ -283,9 +278,11 @@ bool IP_Range::is_coalescable( const IP_Range & other ) const
 
    if( !m_noncontiguous_subnet_mask && !other.m_noncontiguous_subnet_mask )
    {
+      // Both constructors refuse a range that ends before it starts, so the
+      // bounds need no check here.
       predicate =
-         is_on_or_adjacent( other.m_start_address, m_start_address, m_end_address ) ||
-         is_on_or_adjacent( other.m_end_address, m_start_address, m_end_address );
+         is_on_or_adjacent_unchecked( other.m_start_address, m_start_address, m_end_address ) |
+         is_on_or_adjacent_unchecked( other.m_end_address, m_start_address, m_end_address );
    }
 
    return predicate;
@@ -299,6 +296,18 @@ bool IP_Range::is_subnet() const
 }
 
 
+bool IP_Range::has_contiguous_subnet_mask() const
+{
+   return (m_noncontiguous_subnet_mask == contiguous_subnet_mask);
+}
+
+
+uint32_t IP_Range::get_noncontiguous_subnet_mask() const
+{
+   return m_noncontiguous_subnet_mask;
+}
+
+
 uint64_t IP_Range::size() const
 {
    return (static_cast<uint64_t>(m_end_address) - static_cast<uint64_t>(m_start_address)) + 1;
@@ -361,9 +370,47 @@ std::istream & operator >> ( std::istream & istrm, IP_Range & range )
 
 std::ostream & operator << ( std::ostream & ostrm, const IP_Range & range )
 {
-   ostrm << range.to_string();
+   char buffer[IP_Range::max_string_length];
+   ostrm.write( buffer, format_range( buffer, range ) - buffer );
    return ostrm;
 }
 
+
+char * format_range( char * out, const IP_Range & range )
+{
+   if( !range.m_noncontiguous_subnet_mask )
+   {
+      if( (range.size() > 1) && range.is_subnet() )
+      {
+         return range.format_cidr( out );
+      }
+      else
+      {
+         return range.format_start_dash_end( out );
+      }
+   }
+   else
+   {
+      return range.format_start_slash_subnet_mask( out );
+   }
+}
+
+
+char * format_cidr_block( char * out, const IP_Range & block )
+{
+   return block.format_cidr( out );
+}
+
+
+void append_cidr_blocks( const IP_Range & range, std::vector<IP_Range> & blocks )
+{
+   if( !range.has_contiguous_subnet_mask() )
+   {
+      throw std::invalid_argument( "'" + range.to_string() + "' has a non-contiguous subnet mask, so no CIDR form" );
+   }
+
+   append_cidr_blocks( range.get_start_address(), range.get_end_address(), blocks );
+}
+
 } // namespace ip_coalesce
 } // namespace cfeyer
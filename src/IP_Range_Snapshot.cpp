@@ -0,0 +1,324 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <cfeyer/ip_coalesce/IP_Range_Snapshot.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Range_Writer.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+std::string_view as_bytes( const void * data, std::size_t size )
+{
+   return std::string_view( static_cast<const char *>(data), size );
+}
+
+
+// Creates a uniquely named file beside path, with the permissions open()
+// would give a new file.
+int create_temporary_file( const std::string & path, std::string & temporary_path )
+{
+   std::vector<char> name( path.begin(), path.end() );
+   for( char c : std::string_view( ".XXXXXX" ) ) name.push_back( c );
+   name.push_back( '\0' );
+
+   int fd = ::mkostemp( name.data(), O_CLOEXEC );
+
+   if( fd < 0 )
+   {
+      throw std::system_error( errno, std::generic_category(), "Failed to create '" + path + "'" );
+   }
+
+   temporary_path = name.data();
+
+   const mode_t mask = ::umask( 0 );
+   ::umask( mask );
+   ::fchmod( fd, 0666 & ~mask );
+
+   return fd;
+}
+
+
+// Makes a rename into the directory holding path durable.
+void sync_parent_directory( const std::string & path )
+{
+   const std::size_t slash = path.rfind( '/' );
+   const std::string directory = (slash == std::string::npos) ? "." :
+                                 (slash == 0) ? "/" : path.substr( 0, slash );
+
+   int fd = ::open( directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+   if( (fd < 0) || (::fsync( fd ) != 0) )
+   {
+      int error = errno;
+      if( fd >= 0 ) ::close( fd );
+      throw std::system_error( error, std::generic_category(), "Failed to sync directory '" + directory + "'" );
+   }
+
+   ::close( fd );
+}
+
+} // namespace
+
+
+Snapshot_Writer::Snapshot_Writer( const std::string & path ) :
+   m_path( path ),
+   m_fd( create_temporary_file( path, m_temporary_path ) ),
+   m_is_finished( false ),
+   m_range_count( 0 ),
+   m_next_start_address( 0 )
+{
+   m_writer.reset( new Range_Writer( m_fd ) );
+
+   // Zeroed until finish() fills it in, so an unfinished file never loads.
+   Snapshot_Header header = {};
+   m_writer->write( as_bytes( &header, sizeof(header) ) );
+}
+
+
+Snapshot_Writer::~Snapshot_Writer()
+{
+   m_writer.reset();
+   ::close( m_fd );
+
+   if( !m_is_finished )
+   {
+      ::unlink( m_temporary_path.c_str() );
+   }
+}
+
+
+void Snapshot_Writer::add( const IP_Range & range )
+{
+   if( !range.has_contiguous_subnet_mask() )
+   {
+      m_noncontiguous_ranges.push_back( { range.get_start_address(), range.get_noncontiguous_subnet_mask() } );
+      return;
+   }
+
+   if( range.get_start_address() < m_next_start_address )
+   {
+      throw std::invalid_argument( "Snapshot ranges must be coalesced and in ascending order" );
+   }
+
+   Snapshot_Range snapshot_range = { range.get_start_address(), range.get_end_address() };
+   m_writer->write( as_bytes( &snapshot_range, sizeof(snapshot_range) ) );
+
+   m_range_count++;
+   m_next_start_address = static_cast<uint64_t>(range.get_end_address()) + 2;
+}
+
+
+void Snapshot_Writer::finish()
+{
+   m_writer->write( as_bytes( m_noncontiguous_ranges.data(),
+                              m_noncontiguous_ranges.size() * sizeof(Snapshot_Range) ) );
+   m_writer->flush();
+
+   Snapshot_Header header = {};
+   std::memcpy( header.magic, Snapshot_Header::expected_magic, sizeof(header.magic) );
+   header.version = Snapshot_Header::current_version;
+   header.flags = m_noncontiguous_ranges.empty() ? 0 : Snapshot_Header::has_noncontiguous_ranges;
+   header.range_count = m_range_count;
+   header.noncontiguous_range_count = m_noncontiguous_ranges.size();
+
+   if( ::pwrite( m_fd, &header, sizeof(header), 0 ) != static_cast<ssize_t>(sizeof(header)) )
+   {
+      throw std::system_error( errno, std::generic_category(), "Failed to write snapshot header" );
+   }
+
+   // The data must reach the disk before the rename does, or a crash could
+   // leave an empty or partial file at path.
+   if( ::fsync( m_fd ) != 0 )
+   {
+      throw std::system_error( errno, std::generic_category(), "Failed to sync '" + m_temporary_path + "'" );
+   }
+
+   if( ::rename( m_temporary_path.c_str(), m_path.c_str() ) != 0 )
+   {
+      throw std::system_error( errno, std::generic_category(), "Failed to replace '" + m_path + "'" );
+   }
+
+   m_is_finished = true;
+
+   sync_parent_directory( m_path );
+}
+
+
+void save_snapshot( const std::string & path, const Coalescing_IP_Range_Set & set )
+{
+   Snapshot_Writer writer( path );
+
+   for( const IP_Range & range : set )
+   {
+      writer.add( range );
+   }
+
+   writer.finish();
+}
+
+
+IP_Range_Snapshot::IP_Range_Snapshot( const std::string & path ) :
+   m_mapping( nullptr ),
+   m_mapping_size( 0 ),
+   m_ranges( nullptr ),
+   m_range_count( 0 ),
+   m_noncontiguous_ranges( nullptr ),
+   m_noncontiguous_range_count( 0 )
+{
+   int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+   if( fd < 0 )
+   {
+      throw std::system_error( errno, std::generic_category(), "Failed to open '" + path + "'" );
+   }
+
+   struct stat status;
+
+   if( ::fstat( fd, &status ) != 0 )
+   {
+      int error = errno;
+      ::close( fd );
+      throw std::system_error( error, std::generic_category(), "Failed to stat '" + path + "'" );
+   }
+
+   const std::string not_a_snapshot = "'" + path + "' is not an IP range snapshot";
+
+   if( !S_ISREG( status.st_mode ) || (static_cast<std::size_t>(status.st_size) < sizeof(Snapshot_Header)) )
+   {
+      ::close( fd );
+      throw std::runtime_error( not_a_snapshot );
+   }
+
+   void * mapping = ::mmap( nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+   int error = errno;
+   ::close( fd );
+
+   if( mapping == MAP_FAILED )
+   {
+      throw std::system_error( error, std::generic_category(), "Failed to map '" + path + "'" );
+   }
+
+   m_mapping = mapping;
+   m_mapping_size = status.st_size;
+
+   const Snapshot_Header * header = static_cast<const Snapshot_Header *>(m_mapping);
+   const uint64_t max_range_count = (m_mapping_size - sizeof(Snapshot_Header)) / sizeof(Snapshot_Range);
+
+   if( (std::memcmp( header->magic, Snapshot_Header::expected_magic, sizeof(header->magic) ) != 0) ||
+       (header->range_count > max_range_count) ||
+       (header->noncontiguous_range_count > max_range_count - header->range_count) ||
+       (m_mapping_size != sizeof(Snapshot_Header) +
+                          (header->range_count + header->noncontiguous_range_count) * sizeof(Snapshot_Range)) )
+   {
+      ::munmap( mapping, m_mapping_size );
+      throw std::runtime_error( not_a_snapshot );
+   }
+
+   if( header->version != Snapshot_Header::current_version )
+   {
+      ::munmap( mapping, m_mapping_size );
+      throw std::runtime_error( "'" + path + "' is a snapshot of unsupported version " + std::to_string( header->version ) );
+   }
+
+   m_ranges = reinterpret_cast<const Snapshot_Range *>(header + 1);
+   m_range_count = header->range_count;
+
+   m_noncontiguous_ranges = m_ranges + m_range_count;
+   m_noncontiguous_range_count = header->noncontiguous_range_count;
+}
+
+
+IP_Range_Snapshot::~IP_Range_Snapshot()
+{
+   ::munmap( const_cast<void *>(m_mapping), m_mapping_size );
+}
+
+
+std::size_t IP_Range_Snapshot::size() const
+{
+   return m_range_count + m_noncontiguous_range_count;
+}
+
+
+bool IP_Range_Snapshot::contains( uint32_t address ) const
+{
+   // Find the last range starting at or before address.
+   std::size_t low = 0;
+   std::size_t high = m_range_count;
+
+   while( low < high )
+   {
+      std::size_t middle = low + (high - low) / 2;
+
+      if( m_ranges[middle].first <= address )
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle;
+      }
+   }
+
+   return (low > 0) && (address <= m_ranges[low - 1].second);
+}
+
+
+Coalescing_IP_Range_Set IP_Range_Snapshot::to_set() const
+{
+   std::vector<IP_Range> contiguous_ranges;
+   std::vector<IP_Range> noncontiguous_ranges;
+
+   contiguous_ranges.reserve( m_range_count );
+   noncontiguous_ranges.reserve( m_noncontiguous_range_count );
+
+   for( std::size_t i = 0; i < m_range_count; i++ )
+   {
+      contiguous_ranges.push_back( IP_Range::from_start_and_end_addresses( m_ranges[i].first, m_ranges[i].second ) );
+   }
+
+   for( std::size_t i = 0; i < m_noncontiguous_range_count; i++ )
+   {
+      noncontiguous_ranges.push_back( IP_Range( m_noncontiguous_ranges[i].first, m_noncontiguous_ranges[i].second ) );
+   }
+
+   return Coalescing_IP_Range_Set::from_coalesced( contiguous_ranges, noncontiguous_ranges );
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
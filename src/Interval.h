@@ -20,15 +20,44 @@
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //  THE SOFTWARE.
 
+
 #ifndef INTERVAL_H
 #define INTERVAL_H
 
 #include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include <cfeyer/ip_coalesce/Basic_IP_Range.h>
 
 namespace cfeyer {
 namespace ip_coalesce {
 
-bool is_on_or_adjacent( uint32_t x, uint32_t a, uint32_t b );
+// Addresses are IPv4 unless Address is given explicitly, as in
+// is_on_or_adjacent<IP6_Address>( x, a, b ); it is never deduced, so plain
+// integer arguments convert as they would to uint32_t.
+template< typename Address >
+using Interval_Address = typename std::common_type<Address>::type;
+
+
+// Whether x is within [a, b] or next to either end of it.  Does not check
+// that a <= b, and compiles to a pair of comparisons with no branch, for the
+// merge checks in the coalescing loops.
+template< typename Address = uint32_t >
+constexpr bool is_on_or_adjacent_unchecked( Interval_Address<Address> x, Interval_Address<Address> a, Interval_Address<Address> b )
+{
+   return is_at_most_one_past( a, x ) & is_at_most_one_past( x, b );
+}
+
+
+// As above, but throws std::logic_error if b < a.
+template< typename Address = uint32_t >
+constexpr bool is_on_or_adjacent( Interval_Address<Address> x, Interval_Address<Address> a, Interval_Address<Address> b )
+{
+   if( b < a ) throw std::logic_error("Interval end is less than interval start.");
+
+   return is_on_or_adjacent_unchecked<Address>( x, a, b );
+}
 
 }
 }
@@ -0,0 +1,253 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "Ordered_Line_Pipeline.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+struct Batch
+{
+   std::string input;
+   std::string output;
+   std::exception_ptr error;
+   bool is_done = false;
+};
+
+
+// Reads the next batch of whole lines into input, keeping any line cut off
+// at the end of a read in carry for the next batch.  Returns false once the
+// input is exhausted.
+bool read_lines( int fd, std::size_t batch_size, std::string & carry, bool & at_end_of_file, std::string & input )
+{
+   input.swap( carry );
+   carry.clear();
+
+   std::size_t line_end = input.rfind( '\n' );
+
+   while( !at_end_of_file && ((line_end == std::string::npos) || (input.size() < batch_size)) )
+   {
+      std::size_t old_size = input.size();
+      input.resize( old_size + batch_size );
+
+      ssize_t count = ::read( fd, &input[old_size], batch_size );
+
+      if( count < 0 )
+      {
+         input.resize( old_size );
+         if( errno == EINTR ) continue;
+         throw std::system_error( errno, std::generic_category(), "Failed to read input" );
+      }
+
+      input.resize( old_size + count );
+      at_end_of_file = (count == 0);
+
+      std::size_t new_line_end = input.rfind( '\n' );
+      if( (new_line_end != std::string::npos) && (new_line_end >= old_size) )
+      {
+         line_end = new_line_end;
+
+         // Pipes and terminals deliver what they have; hand over the lines
+         // already read rather than waiting for a full batch.
+         if( count < static_cast<ssize_t>(batch_size) ) break;
+      }
+   }
+
+   if( !at_end_of_file && (line_end != std::string::npos) )
+   {
+      carry.assign( input, line_end + 1, std::string::npos );
+      input.resize( line_end + 1 );
+   }
+
+   return !input.empty();
+}
+
+} // namespace
+
+
+Ordered_Line_Pipeline::Ordered_Line_Pipeline( unsigned thread_count,
+                                              const Process_Lines & process_lines,
+                                              const Write_Output & write_output,
+                                              std::size_t batch_size ) :
+   m_thread_count( thread_count ? thread_count : std::max( 1u, std::thread::hardware_concurrency() ) ),
+   m_process_lines( process_lines ),
+   m_write_output( write_output ),
+   m_batch_size( std::max<std::size_t>( batch_size, 1 ) )
+{
+}
+
+
+void Ordered_Line_Pipeline::run( int fd )
+{
+   // Enough batches in flight to keep every worker busy while the calling
+   // thread reads and writes, and no more, so memory stays bounded.
+   std::vector<Batch> batches( 2 * m_thread_count + 1 );
+   std::deque<std::size_t> queue;
+   bool is_shutting_down = false;
+
+   std::mutex mutex;
+   std::condition_variable work_available;
+   std::condition_variable batch_done;
+
+   auto work = [&]()
+   {
+      for( ;; )
+      {
+         std::size_t index;
+         {
+            std::unique_lock<std::mutex> lock( mutex );
+            work_available.wait( lock, [&]() { return is_shutting_down || !queue.empty(); } );
+            if( queue.empty() ) return;
+            index = queue.front();
+            queue.pop_front();
+         }
+
+         Batch & batch = batches[index];
+         try
+         {
+            m_process_lines( batch.input, batch.output );
+         }
+         catch( ... )
+         {
+            batch.error = std::current_exception();
+         }
+
+         {
+            std::lock_guard<std::mutex> lock( mutex );
+            batch.is_done = true;
+         }
+         batch_done.notify_one();
+      }
+   };
+
+   std::vector<std::thread> threads;
+   threads.reserve( m_thread_count );
+   for( unsigned i = 0; i < m_thread_count; i++ )
+   {
+      threads.emplace_back( work );
+   }
+
+   auto stop_workers = [&]()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex );
+         is_shutting_down = true;
+         queue.clear();
+      }
+      work_available.notify_all();
+
+      for( std::thread & thread : threads )
+      {
+         thread.join();
+      }
+   };
+
+   std::size_t next_to_read = 0;
+   std::size_t next_to_write = 0;
+
+   // Writes out the oldest batch, waiting for it if wait is set.  Returns
+   // false if it was not done yet.
+   auto write_oldest = [&]( bool wait )
+   {
+      Batch & batch = batches[next_to_write % batches.size()];
+      {
+         std::unique_lock<std::mutex> lock( mutex );
+         if( wait )
+         {
+            batch_done.wait( lock, [&]() { return batch.is_done; } );
+         }
+         else if( !batch.is_done )
+         {
+            return false;
+         }
+      }
+
+      if( batch.error )
+      {
+         std::rethrow_exception( batch.error );
+      }
+
+      m_write_output( batch.output );
+      batch.output.clear();
+      batch.is_done = false;
+      next_to_write++;
+      return true;
+   };
+
+   try
+   {
+      std::string carry;
+      bool at_end_of_file = false;
+
+      for( ;; )
+      {
+         if( next_to_read - next_to_write == batches.size() )
+         {
+            write_oldest( true );
+         }
+
+         Batch & batch = batches[next_to_read % batches.size()];
+         if( !read_lines( fd, m_batch_size, carry, at_end_of_file, batch.input ) ) break;
+
+         {
+            std::lock_guard<std::mutex> lock( mutex );
+            queue.push_back( next_to_read % batches.size() );
+         }
+         work_available.notify_one();
+         next_to_read++;
+
+         while( (next_to_write < next_to_read) && write_oldest( false ) )
+         {
+         }
+      }
+
+      while( next_to_write < next_to_read )
+      {
+         write_oldest( true );
+      }
+   }
+   catch( ... )
+   {
+      stop_workers();
+      throw;
+   }
+
+   stop_workers();
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
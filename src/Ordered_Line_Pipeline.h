@@ -0,0 +1,72 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef ORDERED_LINE_PIPELINE_H
+#define ORDERED_LINE_PIPELINE_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Transforms newline-separated input on a pool of worker threads without
+// reordering it.  Input is read in large chunks and cut into batches of whole
+// lines; each batch is handed to process_lines on some worker, and the
+// results are passed to write_output on the calling thread in input order.
+// An exception thrown by process_lines is rethrown from run() once the output
+// of every earlier batch has been written.
+class Ordered_Line_Pipeline
+{
+   public:
+
+      // Appends the output for a batch of whole lines, each ending in '\n'
+      // except perhaps the last line of the input.
+      using Process_Lines = std::function<void( std::string_view lines, std::string & output )>;
+
+      using Write_Output = std::function<void( std::string_view output )>;
+
+      static constexpr std::size_t default_batch_size = 1 << 18;
+
+      Ordered_Line_Pipeline( unsigned thread_count,
+                             const Process_Lines & process_lines,
+                             const Write_Output & write_output,
+                             std::size_t batch_size = default_batch_size );
+
+      // Reads fd to the end of input.
+      void run( int fd );
+
+   private:
+
+      unsigned m_thread_count;
+      Process_Lines m_process_lines;
+      Write_Output m_write_output;
+      std::size_t m_batch_size;
+};
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* ORDERED_LINE_PIPELINE_H */
@@ -0,0 +1,401 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "CIDR_Network.h"
+#include "Scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CFEYER_IP_COALESCE_X86 1
+#endif
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+constexpr std::size_t block_size = 64;
+
+// Each classifier returns a bit per byte of a 64-byte block, set where the
+// byte is whitespace in the sense of std::isspace() in the "C" locale.
+using Whitespace_Classifier = uint64_t (*)( const char * block );
+
+
+uint64_t classify_whitespace_scalar( const char * block )
+{
+   uint64_t mask = 0;
+
+   for( std::size_t i = 0; i < block_size; i++ )
+   {
+      mask |= static_cast<uint64_t>(is_whitespace( block[i] )) << i;
+   }
+
+   return mask;
+}
+
+
+#ifdef CFEYER_IP_COALESCE_X86
+
+uint64_t classify_whitespace_sse2( const char * block )
+{
+   const __m128i space = _mm_set1_epi8( ' ' );
+   const __m128i tab = _mm_set1_epi8( '\t' );
+   const __m128i four = _mm_set1_epi8( 4 );
+
+   uint64_t mask = 0;
+
+   for( std::size_t i = 0; i < block_size; i += 16 )
+   {
+      __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i *>(block + i) );
+
+      // '\t' through '\r' are the five consecutive bytes 0x09-0x0d.
+      __m128i offset = _mm_sub_epi8( bytes, tab );
+      __m128i is_control_space = _mm_cmpeq_epi8( _mm_min_epu8( offset, four ), offset );
+      __m128i is_space = _mm_cmpeq_epi8( bytes, space );
+
+      uint32_t lane_mask = _mm_movemask_epi8( _mm_or_si128( is_control_space, is_space ) );
+      mask |= static_cast<uint64_t>(lane_mask) << i;
+   }
+
+   return mask;
+}
+
+
+__attribute__((target("avx2")))
+uint64_t classify_whitespace_avx2( const char * block )
+{
+   const __m256i space = _mm256_set1_epi8( ' ' );
+   const __m256i tab = _mm256_set1_epi8( '\t' );
+   const __m256i four = _mm256_set1_epi8( 4 );
+
+   uint64_t mask = 0;
+
+   for( std::size_t i = 0; i < block_size; i += 32 )
+   {
+      __m256i bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(block + i) );
+
+      __m256i offset = _mm256_sub_epi8( bytes, tab );
+      __m256i is_control_space = _mm256_cmpeq_epi8( _mm256_min_epu8( offset, four ), offset );
+      __m256i is_space = _mm256_cmpeq_epi8( bytes, space );
+
+      uint32_t lane_mask = _mm256_movemask_epi8( _mm256_or_si256( is_control_space, is_space ) );
+      mask |= static_cast<uint64_t>(lane_mask) << i;
+   }
+
+   return mask;
+}
+
+#endif /* CFEYER_IP_COALESCE_X86 */
+
+
+Whitespace_Classifier select_whitespace_classifier()
+{
+#ifdef CFEYER_IP_COALESCE_X86
+   __builtin_cpu_init();
+
+   if( __builtin_cpu_supports( "avx2" ) ) return classify_whitespace_avx2;
+   if( __builtin_cpu_supports( "sse2" ) ) return classify_whitespace_sse2;
+#endif
+
+   return classify_whitespace_scalar;
+}
+
+
+// Calls parse_token( first, last ) for each whitespace-separated token.
+template< typename Token_Parser >
+void for_each_token( std::string_view text, Token_Parser parse_token )
+{
+   static const Whitespace_Classifier classify_whitespace = select_whitespace_classifier();
+
+   const char * const text_begin = text.data();
+   const std::size_t text_size = text.size();
+
+   // Whether the byte just before the current block belongs to a token, and
+   // where that token began.
+   uint64_t previous_is_token = 0;
+   const char * token_begin = nullptr;
+
+   for( std::size_t offset = 0; offset < text_size; offset += block_size )
+   {
+      const char * block = text_begin + offset;
+      uint64_t whitespace;
+
+      if( text_size - offset >= block_size )
+      {
+         whitespace = classify_whitespace( block );
+      }
+      else
+      {
+         char padded_block[block_size];
+         std::size_t tail_size = text_size - offset;
+
+         for( std::size_t i = 0; i < block_size; i++ )
+         {
+            padded_block[i] = (i < tail_size) ? block[i] : ' ';
+         }
+
+         whitespace = classify_whitespace_scalar( padded_block );
+      }
+
+      uint64_t is_token = ~whitespace;
+      uint64_t preceded_by_token = (is_token << 1) | previous_is_token;
+
+      uint64_t token_starts = is_token & ~preceded_by_token;
+      uint64_t token_ends = whitespace & preceded_by_token;
+
+      // Starts and ends alternate, so visiting their union in address order
+      // pairs each token's first byte with the whitespace that follows it.
+      for( uint64_t boundaries = token_starts | token_ends; boundaries != 0; boundaries &= boundaries - 1 )
+      {
+         uint64_t boundary = boundaries & (~boundaries + 1);
+         const char * position = block + __builtin_ctzll( boundaries );
+
+         if( token_starts & boundary )
+         {
+            token_begin = position;
+         }
+         else
+         {
+            parse_token( token_begin, position );
+         }
+      }
+
+      previous_is_token = is_token >> (block_size - 1);
+   }
+
+   if( previous_is_token )
+   {
+      parse_token( token_begin, text_begin + text_size );
+   }
+}
+
+#ifdef CFEYER_IP_COALESCE_X86
+
+using Octet_Shuffle = std::array<uint8_t, 16>;
+
+// One shuffle per way of writing a dotted quad with one to three digits in
+// each octet, indexed by octet_shuffle_index().  Each moves the digits of
+// octet i right-aligned into bytes 4i to 4i+2, zeroing the rest.
+constexpr std::array<Octet_Shuffle, 81> make_octet_shuffles()
+{
+   std::array<Octet_Shuffle, 81> shuffles {};
+
+   for( int index = 0; index < 81; index++ )
+   {
+      int octet_begin = 0;
+
+      for( int i = 0, divisor = 27; i < 4; i++, divisor /= 3 )
+      {
+         int length = 1 + (index / divisor) % 3;
+
+         for( int j = 0; j < 4; j++ )
+         {
+            int digit = j - (3 - length);
+            shuffles[index][4 * i + j] = ((j < 3) && (digit >= 0)) ?
+               static_cast<uint8_t>(octet_begin + digit) : 0x80;
+         }
+
+         octet_begin += length + 1;
+      }
+   }
+
+   return shuffles;
+}
+
+constexpr std::array<Octet_Shuffle, 81> octet_shuffles = make_octet_shuffles();
+
+
+constexpr int octet_shuffle_index( uint32_t l0, uint32_t l1, uint32_t l2, uint32_t l3 )
+{
+   return (l0 - 1) * 27 + (l1 - 1) * 9 + (l2 - 1) * 3 + (l3 - 1);
+}
+
+
+// Converts the dotted quad at the start of the 16 readable bytes at first,
+// which ends at the first byte that is neither a digit nor a dot, or after
+// size bytes.  Returns the length of the quad, or 0 unless it is four octets
+// of one to three digits each, no greater than 255.
+__attribute__((target("ssse3")))
+std::size_t scan_four_octets_ssse3( const char * first, std::size_t size, uint32_t & address )
+{
+   const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i *>(first) );
+   const __m128i digits = _mm_sub_epi8( bytes, _mm_set1_epi8( '0' ) );
+   const __m128i is_digit = _mm_cmpeq_epi8( _mm_min_epu8( digits, _mm_set1_epi8( 9 ) ), digits );
+   const __m128i is_dot = _mm_cmpeq_epi8( bytes, _mm_set1_epi8( '.' ) );
+
+   uint32_t quad_mask = _mm_movemask_epi8( _mm_or_si128( is_digit, is_dot ) );
+   uint32_t limit = (size < 16) ? static_cast<uint32_t>(size) : 16;
+   uint32_t quad_size = __builtin_ctz( ~quad_mask | (1u << limit) );
+
+   uint32_t dot_mask = _mm_movemask_epi8( is_dot ) & ((1u << quad_size) - 1);
+   if( __builtin_popcount( dot_mask ) != 3 ) return 0;
+
+   uint32_t dot0 = __builtin_ctz( dot_mask );
+   dot_mask &= dot_mask - 1;
+   uint32_t dot1 = __builtin_ctz( dot_mask );
+   dot_mask &= dot_mask - 1;
+   uint32_t dot2 = __builtin_ctz( dot_mask );
+
+   uint32_t l0 = dot0;
+   uint32_t l1 = dot1 - dot0 - 1;
+   uint32_t l2 = dot2 - dot1 - 1;
+   uint32_t l3 = quad_size - dot2 - 1;
+
+   // Unsigned wrap-around also rejects empty octets here.
+   if( ((l0 - 1) > 2) || ((l1 - 1) > 2) || ((l2 - 1) > 2) || ((l3 - 1) > 2) ) return 0;
+
+   const __m128i shuffle = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(octet_shuffles[octet_shuffle_index( l0, l1, l2, l3 )].data()) );
+   const __m128i octet_digits = _mm_shuffle_epi8( digits, shuffle );
+
+   // 100 * hundreds + 10 * tens, then + ones, in each 32-bit lane.
+   const __m128i partial = _mm_maddubs_epi16( octet_digits, _mm_set1_epi32( 0x00010a64 ) );
+   const __m128i octets = _mm_madd_epi16( partial, _mm_set1_epi16( 1 ) );
+
+   if( _mm_movemask_epi8( _mm_cmpgt_epi32( octets, _mm_set1_epi32( 0xff ) ) ) != 0 ) return 0;
+
+   const __m128i words = _mm_packs_epi32( octets, octets );
+   const __m128i packed = _mm_packus_epi16( words, words );
+   address = __builtin_bswap32( static_cast<uint32_t>(_mm_cvtsi128_si32( packed )) );
+
+   return quad_size;
+}
+
+
+// Parses the a.b.c.d, a.b.c.d/n and a.b.c.d-e.f.g.h forms of the token
+// [first, last) directly, each dotted quad converted with SSSE3.  Returns
+// false for anything else, or when a quad lies within 16 bytes of
+// text_last, leaving the token to IP_Range::from_string().
+__attribute__((target("ssse3")))
+bool parse_range_ssse3( const char * first, const char * last, const char * text_last, IP_Range & range )
+{
+   uint32_t start_address = 0;
+
+   if( text_last - first < 16 ) return false;
+
+   std::size_t quad_size = scan_four_octets_ssse3( first, last - first, start_address );
+   if( quad_size == 0 ) return false;
+
+   const char * pos = first + quad_size;
+
+   if( pos == last )
+   {
+      range = IP_Range( start_address, 0xffffffff );
+      return true;
+   }
+
+   const char delimiter = *pos++;
+
+   if( delimiter == '/' )
+   {
+      uint32_t length = 0;
+      if( !scan_decimal( pos, last, 32, length ) || (pos != last) ) return false;
+
+      range = IP_Range( start_address, size_to_subnet_mask( netmask_length_to_address_count( length ) ) );
+      return true;
+   }
+
+   if( (delimiter == '-') && (text_last - pos >= 16) )
+   {
+      uint32_t end_address = 0;
+
+      quad_size = scan_four_octets_ssse3( pos, last - pos, end_address );
+      if( (quad_size == 0) || (pos + quad_size != last) || (end_address < start_address) ) return false;
+
+      range = IP_Range::from_start_and_end_addresses( start_address, end_address );
+      return true;
+   }
+
+   return false;
+}
+
+#endif /* CFEYER_IP_COALESCE_X86 */
+
+
+// Parses the token [first, last) of text ending at text_last into range,
+// returning false if it must go through IP_Range::from_string() instead.
+bool parse_range_fast( const char * first, const char * last, const char * text_last, IP_Range & range )
+{
+#ifdef CFEYER_IP_COALESCE_X86
+   static const bool has_ssse3 = (__builtin_cpu_init(), __builtin_cpu_supports( "ssse3" ));
+
+   if( has_ssse3 ) return parse_range_ssse3( first, last, text_last, range );
+#endif
+
+   return false;
+}
+
+} // namespace
+
+
+void parse_ranges( std::string_view text, std::vector<IP_Range> & ranges )
+{
+   const char * const text_last = text.data() + text.size();
+
+   for_each_token( text, [&]( const char * first, const char * last )
+   {
+      IP_Range range;
+      if( !parse_range_fast( first, last, text_last, range ) )
+      {
+         range.from_string( std::string_view( first, last - first ) );
+      }
+      ranges.push_back( range );
+   } );
+}
+
+
+void parse_ranges( std::string_view text, std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges )
+{
+   const char * const text_last = text.data() + text.size();
+
+   for_each_token( text, [&]( const char * first, const char * last )
+   {
+      std::string_view token( first, last - first );
+
+      IP_Range range;
+      if( parse_range_fast( first, last, text_last, range ) || range.try_from_string( token ) )
+      {
+         ranges.push_back( range );
+         return;
+      }
+
+      IP6_Range ip6_range;
+      if( try_parse_ip6_range( token, ip6_range ) )
+      {
+         ip6_ranges.push_back( ip6_range );
+         return;
+      }
+
+      // Neither; report it as before.
+      range.from_string( token );
+   } );
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
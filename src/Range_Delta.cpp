@@ -0,0 +1,137 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "Range_Delta.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <cfeyer/ip_coalesce/Range_Set_Algebra.h>
+
+#include "Scan.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+[[noreturn]] void throw_bad_change( std::string_view token )
+{
+   std::ostringstream msg;
+   msg << "Failed to parse change '" << token << "'.";
+   throw std::runtime_error( msg.str() );
+}
+
+} // namespace
+
+
+void parse_range_changes( std::string_view text,
+                          std::vector<Range_Change> & changes,
+                          std::vector<IP6_Range_Change> & ip6_changes )
+{
+   std::size_t position = 0;
+
+   while( position < text.size() )
+   {
+      if( is_whitespace( text[position] ) )
+      {
+         position++;
+         continue;
+      }
+
+      std::size_t token_end = position;
+      while( (token_end < text.size()) && !is_whitespace( text[token_end] ) )
+      {
+         token_end++;
+      }
+
+      std::string_view token = text.substr( position, token_end - position );
+      position = token_end;
+
+      if( (token.size() < 2) || ((token[0] != '+') && (token[0] != '-')) )
+      {
+         throw_bad_change( token );
+      }
+
+      const bool is_addition = (token[0] == '+');
+      std::string_view range_text = token.substr( 1 );
+
+      IP_Range range;
+      IP6_Range ip6_range;
+
+      if( range.try_from_string( range_text ) )
+      {
+         changes.push_back( { is_addition, range } );
+      }
+      else if( try_parse_ip6_range( range_text, ip6_range ) )
+      {
+         ip6_changes.push_back( { is_addition, ip6_range } );
+      }
+      else
+      {
+         throw_bad_change( token );
+      }
+   }
+}
+
+
+void apply_range_changes( const std::vector<Range_Change> & changes, Coalescing_IP_Range_Set & set )
+{
+   for( const Range_Change & change : changes )
+   {
+      if( change.is_addition )
+      {
+         set.insert( change.range );
+      }
+      else
+      {
+         set.erase( change.range );
+      }
+   }
+}
+
+
+void apply_range_changes( const std::vector<IP6_Range_Change> & changes, std::vector<IP6_Range> & ranges )
+{
+   std::vector<IP6_Range> changed_ranges;
+
+   for( const IP6_Range_Change & change : changes )
+   {
+      const std::vector<IP6_Range> change_ranges = { change.range };
+
+      changed_ranges.clear();
+
+      if( change.is_addition )
+      {
+         append_union( ranges, change_ranges, changed_ranges );
+      }
+      else
+      {
+         append_difference( ranges, change_ranges, changed_ranges );
+      }
+
+      ranges.swap( changed_ranges );
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
@@ -0,0 +1,63 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef RANGE_DELTA_H
+#define RANGE_DELTA_H
+
+#include <string_view>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// One entry of a delta file: a range to add or to remove.
+template< typename Range >
+struct Basic_Range_Change
+{
+   bool is_addition;
+   Range range;
+};
+
+using Range_Change = Basic_Range_Change<IP_Range>;
+using IP6_Range_Change = Basic_Range_Change<IP6_Range>;
+
+// Parses whitespace-separated "+RANGE" and "-RANGE" tokens, keeping their
+// order.  Throws std::runtime_error on any other token.
+void parse_range_changes( std::string_view text,
+                          std::vector<Range_Change> & changes,
+                          std::vector<IP6_Range_Change> & ip6_changes );
+
+// Applies changes in order, each with one insert() or erase().
+void apply_range_changes( const std::vector<Range_Change> & changes, Coalescing_IP_Range_Set & set );
+
+// Applies changes in order to coalesced IPv6 ranges, each in one linear
+// merge.
+void apply_range_changes( const std::vector<IP6_Range_Change> & changes, std::vector<IP6_Range> & ranges );
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* RANGE_DELTA_H */
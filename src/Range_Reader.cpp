@@ -0,0 +1,283 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "Range_Reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Scan.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+Range_Reader::Range_Reader( const std::string & path, std::size_t chunk_size ) :
+   m_fd( ::open( path.c_str(), O_RDONLY | O_CLOEXEC ) ),
+   m_owns_fd( true ),
+   m_chunk_size( std::max<std::size_t>( chunk_size, 1 ) ),
+   m_mapping( nullptr ),
+   m_mapping_size( 0 ),
+   m_mapping_offset( 0 ),
+   m_buffered_size( 0 ),
+   m_at_end_of_input( false )
+{
+   if( m_fd < 0 )
+   {
+      throw std::system_error( errno, std::generic_category(), "Failed to open '" + path + "'" );
+   }
+
+   open_input();
+}
+
+
+Range_Reader::Range_Reader( int fd, std::size_t chunk_size ) :
+   m_fd( fd ),
+   m_owns_fd( false ),
+   m_chunk_size( std::max<std::size_t>( chunk_size, 1 ) ),
+   m_mapping( nullptr ),
+   m_mapping_size( 0 ),
+   m_mapping_offset( 0 ),
+   m_buffered_size( 0 ),
+   m_at_end_of_input( false )
+{
+   open_input();
+}
+
+
+Range_Reader::~Range_Reader()
+{
+   if( m_mapping )
+   {
+      ::munmap( const_cast<char *>(m_mapping), m_mapping_size );
+   }
+
+   if( m_owns_fd )
+   {
+      ::close( m_fd );
+   }
+}
+
+
+void Range_Reader::open_input()
+{
+   struct stat status;
+
+   if( (::fstat( m_fd, &status ) == 0) && S_ISREG( status.st_mode ) )
+   {
+      off_t offset = ::lseek( m_fd, 0, SEEK_CUR );
+      if( offset < 0 ) offset = 0;
+
+      if( status.st_size <= offset )
+      {
+         m_at_end_of_input = true;
+         return;
+      }
+
+      void * mapping = ::mmap( nullptr, status.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+
+      if( mapping != MAP_FAILED )
+      {
+         ::madvise( mapping, status.st_size, MADV_SEQUENTIAL );
+
+         m_mapping = static_cast<const char *>(mapping);
+         m_mapping_size = status.st_size;
+         m_mapping_offset = offset;
+         return;
+      }
+   }
+
+   m_buffer.resize( m_chunk_size );
+}
+
+
+bool Range_Reader::is_memory_mapped() const
+{
+   return (m_mapping != nullptr);
+}
+
+
+bool Range_Reader::read_chunk( std::vector<IP_Range> & ranges )
+{
+   return read_next_chunk( ranges, nullptr );
+}
+
+
+void Range_Reader::read_all( std::vector<IP_Range> & ranges )
+{
+   while( read_next_chunk( ranges, nullptr ) )
+   {
+   }
+}
+
+
+bool Range_Reader::read_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges )
+{
+   return read_next_chunk( ranges, &ip6_ranges );
+}
+
+
+void Range_Reader::read_all( std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges )
+{
+   while( read_next_chunk( ranges, &ip6_ranges ) )
+   {
+   }
+}
+
+
+const Range_Reader::Statistics & Range_Reader::get_statistics() const
+{
+   return m_statistics;
+}
+
+
+bool Range_Reader::read_next_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges )
+{
+   if( m_at_end_of_input ) return false;
+
+   return m_mapping ? read_mapped_chunk( ranges, ip6_ranges ) : read_buffered_chunk( ranges, ip6_ranges );
+}
+
+
+bool Range_Reader::read_mapped_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges )
+{
+   if( m_mapping_offset == m_mapping_size )
+   {
+      m_at_end_of_input = true;
+      return false;
+   }
+
+   std::size_t chunk_end = std::min( m_mapping_offset + m_chunk_size, m_mapping_size );
+
+   while( (chunk_end < m_mapping_size) && !is_whitespace( m_mapping[chunk_end] ) )
+   {
+      chunk_end++;
+   }
+
+   parse_text( std::string_view( m_mapping + m_mapping_offset, chunk_end - m_mapping_offset ), ranges, ip6_ranges );
+
+   // Input is read once, front to back, so drop the pages already parsed
+   // rather than letting them accumulate in the resident set.
+   static const std::size_t page_size = ::sysconf( _SC_PAGESIZE );
+   std::size_t release_begin = m_mapping_offset - (m_mapping_offset % page_size);
+   std::size_t release_end = chunk_end - (chunk_end % page_size);
+
+   if( release_end > release_begin )
+   {
+      ::madvise( const_cast<char *>(m_mapping) + release_begin, release_end - release_begin, MADV_DONTNEED );
+   }
+
+   m_mapping_offset = chunk_end;
+
+   return true;
+}
+
+
+bool Range_Reader::read_buffered_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges )
+{
+   bool at_end_of_file = false;
+
+   while( !at_end_of_file && (m_buffered_size < m_buffer.size()) )
+   {
+      ssize_t count = ::read( m_fd, m_buffer.data() + m_buffered_size, m_buffer.size() - m_buffered_size );
+
+      if( count < 0 )
+      {
+         if( errno == EINTR ) continue;
+         throw std::system_error( errno, std::generic_category(), "Failed to read input" );
+      }
+
+      at_end_of_file = (count == 0);
+      m_buffered_size += count;
+   }
+
+   std::size_t parse_end = m_buffered_size;
+
+   if( !at_end_of_file )
+   {
+      // Leave a token cut off at the end of the buffer for the next read.
+      while( (parse_end > 0) && !is_whitespace( m_buffer[parse_end - 1] ) )
+      {
+         parse_end--;
+      }
+
+      if( parse_end == 0 )
+      {
+         m_buffer.resize( m_buffer.size() * 2 );
+         return true;
+      }
+   }
+
+   parse_text( std::string_view( m_buffer.data(), parse_end ), ranges, ip6_ranges );
+
+   std::memmove( m_buffer.data(), m_buffer.data() + parse_end, m_buffered_size - parse_end );
+   m_buffered_size -= parse_end;
+
+   m_at_end_of_input = at_end_of_file;
+
+   return true;
+}
+
+
+// Tokens are counted from how far the output grows, which costs nothing per
+// token.  The valid tokens before one that fails to parse count too.
+void Range_Reader::parse_text( std::string_view text, std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges )
+{
+   const std::size_t range_count = ranges.size();
+   const std::size_t ip6_range_count = ip6_ranges ? ip6_ranges->size() : 0;
+
+   auto count_tokens = [&]()
+   {
+      m_statistics.tokens_parsed += (ranges.size() - range_count) +
+                                    (ip6_ranges ? ip6_ranges->size() - ip6_range_count : 0);
+   };
+
+   try
+   {
+      if( ip6_ranges )
+      {
+         parse_ranges( text, ranges, *ip6_ranges );
+      }
+      else
+      {
+         parse_ranges( text, ranges );
+      }
+   }
+   catch( ... )
+   {
+      count_tokens();
+      m_statistics.stopped_on_parse_failure = true;
+      throw;
+   }
+
+   count_tokens();
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
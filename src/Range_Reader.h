@@ -0,0 +1,106 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef RANGE_READER_H
+#define RANGE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Parses whitespace-separated ranges from a file or descriptor a chunk at a
+// time, straight out of the input bytes.  Regular files are memory-mapped and
+// read in place; pipes and terminals are read through a reusable buffer.
+class Range_Reader
+{
+   public:
+
+      static constexpr std::size_t default_chunk_size = 1 << 20;
+
+      explicit Range_Reader( const std::string & path, std::size_t chunk_size = default_chunk_size );
+      explicit Range_Reader( int fd, std::size_t chunk_size = default_chunk_size );
+      ~Range_Reader();
+
+      Range_Reader( const Range_Reader & ) = delete;
+      Range_Reader & operator = ( const Range_Reader & ) = delete;
+
+      // Appends the ranges parsed from the next chunk of input (about
+      // chunk_size bytes, extended to the end of the last token).  Returns
+      // false once the input is exhausted.
+      bool read_chunk( std::vector<IP_Range> & ranges );
+
+      void read_all( std::vector<IP_Range> & ranges );
+
+      // As above, for input mixing IPv4 and IPv6 ranges.
+      bool read_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges );
+
+      void read_all( std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges );
+
+      bool is_memory_mapped() const;
+
+      // The count of tokens parsed so far, and whether a token failed to
+      // parse, which ends the read with an exception.
+      struct Statistics
+      {
+         uint64_t tokens_parsed = 0;
+         bool stopped_on_parse_failure = false;
+      };
+
+      const Statistics & get_statistics() const;
+
+   private:
+
+      void open_input();
+
+      // ip6_ranges is null for IPv4-only input.
+      bool read_next_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges );
+      bool read_mapped_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges );
+      bool read_buffered_chunk( std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges );
+      void parse_text( std::string_view text, std::vector<IP_Range> & ranges, std::vector<IP6_Range> * ip6_ranges );
+
+      int m_fd;
+      bool m_owns_fd;
+      std::size_t m_chunk_size;
+
+      const char * m_mapping;
+      std::size_t m_mapping_size;
+      std::size_t m_mapping_offset;
+
+      std::vector<char> m_buffer;
+      std::size_t m_buffered_size;
+      bool m_at_end_of_input;
+
+      Statistics m_statistics;
+};
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* RANGE_READER_H */
@@ -0,0 +1,107 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "Range_Writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+Range_Writer::Range_Writer( int fd, bool is_line_buffered, std::size_t buffer_size ) :
+   m_fd( fd ),
+   m_is_line_buffered( is_line_buffered ),
+   m_buffer( std::max( { buffer_size, IP_Range::max_string_length, max_ip6_range_string_length } ) ),
+   m_buffered_size( 0 )
+{
+}
+
+
+Range_Writer::~Range_Writer()
+{
+   try
+   {
+      flush();
+   }
+   catch( const std::system_error & )
+   {
+   }
+}
+
+
+void Range_Writer::write( std::string_view text )
+{
+   if( text.size() > m_buffer.size() - m_buffered_size )
+   {
+      flush();
+
+      if( text.size() > m_buffer.size() )
+      {
+         m_buffer.resize( text.size() );
+      }
+   }
+
+   std::memcpy( m_buffer.data() + m_buffered_size, text.data(), text.size() );
+   m_buffered_size += text.size();
+}
+
+
+void Range_Writer::end_line()
+{
+   write( '\n' );
+
+   if( m_is_line_buffered )
+   {
+      flush();
+   }
+}
+
+
+void Range_Writer::flush()
+{
+   std::size_t written = 0;
+
+   while( written < m_buffered_size )
+   {
+      ssize_t count = ::write( m_fd, m_buffer.data() + written, m_buffered_size - written );
+
+      if( count < 0 )
+      {
+         if( errno == EINTR ) continue;
+         m_buffered_size = 0;
+         throw std::system_error( errno, std::generic_category(), "Failed to write output" );
+      }
+
+      written += count;
+   }
+
+   m_buffered_size = 0;
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
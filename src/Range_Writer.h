@@ -0,0 +1,123 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef RANGE_WRITER_H
+#define RANGE_WRITER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Formats ranges and text straight into a reusable buffer and writes it to a
+// descriptor with write(2) a block at a time.  When line buffered, each
+// end_line() also flushes, for interactive pipelines.
+class Range_Writer
+{
+   public:
+
+      static constexpr std::size_t default_buffer_size = 1 << 16;
+
+      explicit Range_Writer( int fd, bool is_line_buffered = false, std::size_t buffer_size = default_buffer_size );
+
+      // Flushes what is left, ignoring errors; call flush() first to see them.
+      ~Range_Writer();
+
+      Range_Writer( const Range_Writer & ) = delete;
+      Range_Writer & operator = ( const Range_Writer & ) = delete;
+
+      void write( const IP_Range & range );
+      void write( const IP6_Range & range );
+      void write_cidr_block( const IP_Range & block );
+      void write_cidr_block( const IP6_Range & block );
+      void write( std::string_view text );
+      void write( char c );
+
+      void end_line();
+
+      void flush();
+
+   private:
+
+      void make_room( std::size_t length );
+
+      int m_fd;
+      bool m_is_line_buffered;
+
+      std::vector<char> m_buffer;
+      std::size_t m_buffered_size;
+};
+
+
+inline void Range_Writer::write( const IP_Range & range )
+{
+   make_room( IP_Range::max_string_length );
+   m_buffered_size = format_range( m_buffer.data() + m_buffered_size, range ) - m_buffer.data();
+}
+
+
+inline void Range_Writer::write( const IP6_Range & range )
+{
+   make_room( max_ip6_range_string_length );
+   m_buffered_size = format_range( m_buffer.data() + m_buffered_size, range ) - m_buffer.data();
+}
+
+
+inline void Range_Writer::write_cidr_block( const IP_Range & block )
+{
+   make_room( IP_Range::max_string_length );
+   m_buffered_size = format_cidr_block( m_buffer.data() + m_buffered_size, block ) - m_buffer.data();
+}
+
+
+inline void Range_Writer::write_cidr_block( const IP6_Range & block )
+{
+   make_room( max_ip6_range_string_length );
+   m_buffered_size = format_cidr_block( m_buffer.data() + m_buffered_size, block ) - m_buffer.data();
+}
+
+
+inline void Range_Writer::write( char c )
+{
+   make_room( 1 );
+   m_buffer[m_buffered_size++] = c;
+}
+
+
+inline void Range_Writer::make_room( std::size_t length )
+{
+   if( m_buffered_size + length > m_buffer.size() )
+   {
+      flush();
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* RANGE_WRITER_H */
@@ -0,0 +1,214 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "Run_Statistics.h"
+
+#include <iomanip>
+
+#include <time.h>
+#include <sys/resource.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+double seconds_between( std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end )
+{
+   return std::chrono::duration<double>( end - start ).count();
+}
+
+
+void print_times( std::ostream & out, const std::string & label, double wall_seconds, double cpu_seconds )
+{
+   out << "  " << std::left << std::setw( 28 ) << label << std::right
+       << std::fixed << std::setprecision( 3 )
+       << "wall " << std::setw( 9 ) << wall_seconds << " s   "
+       << "cpu " << std::setw( 9 ) << cpu_seconds << " s\n";
+}
+
+
+template< typename Value >
+void print_value( std::ostream & out, const char * label, const Value & value )
+{
+   out << "  " << std::left << std::setw( 28 ) << label << std::right << value << '\n';
+}
+
+} // namespace
+
+
+void Run_Counters::count_output_range( const IP_Range & range )
+{
+   output_ranges++;
+
+   if( range.has_contiguous_subnet_mask() )
+   {
+      addresses_covered += range.size();
+   }
+   else
+   {
+      addresses_covered += uint64_t( 1 ) << (32 - __builtin_popcount( range.get_noncontiguous_subnet_mask() ));
+   }
+}
+
+
+void Run_Counters::count_output_range( const IP6_Range & range )
+{
+   output_ranges++;
+   ip6_addresses_covered += static_cast<long double>( range.get_end_address() - range.get_start_address() ) + 1;
+}
+
+
+Run_Counters & Run_Counters::operator += ( const Run_Counters & other )
+{
+   input_lines += other.input_lines;
+   input_tokens += other.input_tokens;
+   stopped_on_parse_failure = stopped_on_parse_failure || other.stopped_on_parse_failure;
+   ranges_inserted += other.ranges_inserted;
+   merges += other.merges;
+   output_ranges += other.output_ranges;
+   addresses_covered += other.addresses_covered;
+   ip6_addresses_covered += other.ip6_addresses_covered;
+
+   return *this;
+}
+
+
+Run_Statistics::Run_Statistics( bool is_enabled ) :
+   m_is_enabled( is_enabled ),
+   m_is_in_phase( false ),
+   m_phase_cpu_start( 0 ),
+   m_wall_start( std::chrono::steady_clock::now() ),
+   m_cpu_start( is_enabled ? process_cpu_seconds() : 0 )
+{
+}
+
+
+bool Run_Statistics::is_enabled() const
+{
+   return m_is_enabled;
+}
+
+
+void Run_Statistics::begin_phase( const char * name )
+{
+   if( !m_is_enabled ) return;
+
+   end_phase();
+
+   m_phases.push_back( { name, 0, 0 } );
+   m_is_in_phase = true;
+   m_phase_wall_start = std::chrono::steady_clock::now();
+   m_phase_cpu_start = process_cpu_seconds();
+}
+
+
+void Run_Statistics::end_phase()
+{
+   if( !m_is_in_phase ) return;
+
+   m_phases.back().wall_seconds = seconds_between( m_phase_wall_start, std::chrono::steady_clock::now() );
+   m_phases.back().cpu_seconds = process_cpu_seconds() - m_phase_cpu_start;
+   m_is_in_phase = false;
+}
+
+
+Run_Counters & Run_Statistics::counters()
+{
+   return m_counters;
+}
+
+
+const Run_Counters & Run_Statistics::counters() const
+{
+   return m_counters;
+}
+
+
+void Run_Statistics::print( std::ostream & out ) const
+{
+   if( !m_is_enabled ) return;
+
+   const double wall_seconds = seconds_between( m_wall_start, std::chrono::steady_clock::now() );
+   const double cpu_seconds = process_cpu_seconds() - m_cpu_start;
+
+   const std::ios_base::fmtflags flags = out.flags();
+   const std::streamsize precision = out.precision();
+
+   out << "statistics:\n";
+
+   if( m_counters.input_lines > 0 )
+   {
+      print_value( out, "input lines", m_counters.input_lines );
+   }
+
+   print_value( out, "input tokens", m_counters.input_tokens );
+   print_value( out, "stopped on parse failure", m_counters.stopped_on_parse_failure ? "yes" : "no" );
+   print_value( out, "ranges inserted", m_counters.ranges_inserted );
+   print_value( out, "merges performed", m_counters.merges );
+   print_value( out, "final ranges", m_counters.output_ranges );
+   print_value( out, "addresses covered", m_counters.addresses_covered );
+
+   if( m_counters.ip6_addresses_covered > 0 )
+   {
+      out << std::scientific << std::setprecision( 6 );
+      print_value( out, "IPv6 addresses covered", m_counters.ip6_addresses_covered );
+      out.flags( flags );
+      out.precision( precision );
+   }
+
+   for( const Phase & phase : m_phases )
+   {
+      print_times( out, "phase " + phase.name, phase.wall_seconds, phase.cpu_seconds );
+   }
+
+   print_times( out, "total", wall_seconds, cpu_seconds );
+   out.flags( flags );
+   out.precision( precision );
+
+   const double throughput = (wall_seconds > 0) ? m_counters.input_tokens / wall_seconds : 0;
+   print_value( out, "throughput", std::to_string( static_cast<uint64_t>( throughput ) ) + " ranges/s" );
+   print_value( out, "peak RSS", std::to_string( peak_resident_set_bytes() >> 10 ) + " KiB" );
+}
+
+
+double process_cpu_seconds()
+{
+   timespec time = {};
+   ::clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &time );
+
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+
+uint64_t peak_resident_set_bytes()
+{
+   rusage usage = {};
+   ::getrusage( RUSAGE_SELF, &usage );
+
+   // Linux reports ru_maxrss in kilobytes.
+   return static_cast<uint64_t>( usage.ru_maxrss ) << 10;
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
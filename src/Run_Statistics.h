@@ -0,0 +1,119 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef RUN_STATISTICS_H
+#define RUN_STATISTICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+struct Run_Counters
+{
+   // Input tokens include the one that failed to parse, if any; the first
+   // such token ends the run.  Input lines are counted by ip-coalesce-table
+   // only.
+   uint64_t input_lines = 0;
+   uint64_t input_tokens = 0;
+   bool stopped_on_parse_failure = false;
+
+   uint64_t ranges_inserted = 0;
+   uint64_t merges = 0;
+
+   // Final ranges before any splitting into CIDR blocks, and the addresses
+   // they cover.  A range with a non-contiguous subnet mask covers the
+   // addresses matching its pattern.
+   uint64_t output_ranges = 0;
+   uint64_t addresses_covered = 0;
+   long double ip6_addresses_covered = 0;
+
+   void count_output_range( const IP_Range & range );
+   void count_output_range( const IP6_Range & range );
+
+   Run_Counters & operator += ( const Run_Counters & other );
+};
+
+
+// Counters and per-phase wall and CPU times for the --stats report.  When
+// disabled, beginning and ending a phase only test a flag, and the report is
+// empty.  CPU time is for the whole process, so it includes every thread.
+class Run_Statistics
+{
+   public:
+
+      explicit Run_Statistics( bool is_enabled );
+
+      bool is_enabled() const;
+
+      // Ends the current phase, if any, and starts timing the named one.
+      void begin_phase( const char * name );
+      void end_phase();
+
+      Run_Counters & counters();
+      const Run_Counters & counters() const;
+
+      // Writes the counters, the time of each phase and in all, the input
+      // tokens per second of the total wall time, and the peak resident set
+      // size.
+      void print( std::ostream & out ) const;
+
+   private:
+
+      struct Phase
+      {
+         std::string name;
+         double wall_seconds;
+         double cpu_seconds;
+      };
+
+      bool m_is_enabled;
+      Run_Counters m_counters;
+
+      std::vector<Phase> m_phases;
+      bool m_is_in_phase;
+      std::chrono::steady_clock::time_point m_phase_wall_start;
+      double m_phase_cpu_start;
+
+      std::chrono::steady_clock::time_point m_wall_start;
+      double m_cpu_start;
+};
+
+
+// Process CPU time used so far, in seconds.
+double process_cpu_seconds();
+
+// Peak resident set size of the process so far, in bytes.
+uint64_t peak_resident_set_bytes();
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* RUN_STATISTICS_H */
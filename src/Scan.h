@@ -0,0 +1,86 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstdint>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Scanners shared by every tokenizer and range parser, inline here since they
+// run for every byte of input.  Each scan_*() advances pos past what it
+// accepts, never reading at or beyond last.
+
+// Whitespace as operator >> on a std::string skips it in the "C" locale.
+inline bool is_whitespace( char c )
+{
+   return (c == ' ') || (static_cast<unsigned char>(c - '\t') < 5);
+}
+
+
+// Scans one or more decimal digits at pos, failing if there are none or the
+// value exceeds max_value.
+inline bool scan_decimal( const char * & pos, const char * last, uint32_t max_value, uint32_t & value )
+{
+   const char * digits_begin = pos;
+   value = 0;
+
+   while( (pos != last) && (static_cast<unsigned char>(*pos - '0') < 10) )
+   {
+      value = (value * 10) + static_cast<uint32_t>(*pos - '0');
+      if( value > max_value ) return false;
+      pos++;
+   }
+
+   return (pos != digits_begin);
+}
+
+
+// Scans a dotted quad such as 192.168.0.1.
+inline bool scan_four_octets( const char * & pos, const char * last, uint32_t & address )
+{
+   address = 0;
+
+   for( int i = 0; i < 4; i++ )
+   {
+      if( i > 0 )
+      {
+         if( (pos == last) || (*pos != '.') ) return false;
+         pos++;
+      }
+
+      uint32_t octet = 0;
+      if( !scan_decimal( pos, last, 0xff, octet ) ) return false;
+
+      address = (address << 8) | octet;
+   }
+
+   return true;
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* SCAN_H */
@@ -0,0 +1,168 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "Small_Range_Coalescer.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+// Stable, so equal elements keep their input order.
+template< typename T >
+void insertion_sort( T * first, T * last )
+{
+   for( T * iter = first; iter != last; iter++ )
+   {
+      T value = *iter;
+      T * hole = iter;
+
+      for( ; (hole != first) && (value < *(hole - 1)); hole-- )
+      {
+         *hole = *(hole - 1);
+      }
+
+      *hole = value;
+   }
+}
+
+} // namespace
+
+
+Small_Range_Coalescer::Small_Range_Coalescer() :
+   m_size( 0 )
+{
+}
+
+
+void Small_Range_Coalescer::clear()
+{
+   m_size = 0;
+}
+
+
+std::size_t Small_Range_Coalescer::size() const
+{
+   return m_size;
+}
+
+
+const IP_Range * Small_Range_Coalescer::begin() const
+{
+   return m_ranges.data();
+}
+
+
+const IP_Range * Small_Range_Coalescer::end() const
+{
+   return m_ranges.data() + m_size;
+}
+
+
+void Small_Range_Coalescer::coalesce()
+{
+   // Set the ranges with non-contiguous subnet masks aside; they are never
+   // coalesced, only merged back in order at the end.
+   // Ranges with contiguous masks are fully described by their bounds, so
+   // sort and coalesce those as plain (start, end) keys.
+   std::size_t contiguous_count = 0;
+   std::size_t noncontiguous_count = 0;
+
+   for( std::size_t i = 0; i < m_size; i++ )
+   {
+      if( m_ranges[i].has_contiguous_subnet_mask() )
+      {
+         m_keys[contiguous_count++] = (static_cast<uint64_t>(m_ranges[i].get_start_address()) << 32) |
+                                      m_ranges[i].get_end_address();
+      }
+      else
+      {
+         m_noncontiguous_ranges[noncontiguous_count++] = m_ranges[i];
+      }
+   }
+
+   insertion_sort( m_keys.data(), m_keys.data() + contiguous_count );
+
+   std::size_t coalesced_count = 0;
+   uint64_t start_address = 0;
+   uint64_t end_address = 0;
+
+   for( std::size_t i = 0; i < contiguous_count; i++ )
+   {
+      uint64_t key_start_address = m_keys[i] >> 32;
+      uint64_t key_end_address = m_keys[i] & 0xffffffff;
+
+      if( (i > 0) && (key_start_address <= end_address + 1) )
+      {
+         end_address = std::max( end_address, key_end_address );
+         continue;
+      }
+
+      if( i > 0 )
+      {
+         m_ranges[coalesced_count++] = IP_Range::from_start_and_end_addresses( start_address, end_address );
+      }
+
+      start_address = key_start_address;
+      end_address = key_end_address;
+   }
+
+   if( contiguous_count > 0 )
+   {
+      m_ranges[coalesced_count++] = IP_Range::from_start_and_end_addresses( start_address, end_address );
+   }
+
+   m_size = coalesced_count;
+
+   if( noncontiguous_count == 0 ) return;
+
+   insertion_sort( m_noncontiguous_ranges.data(), m_noncontiguous_ranges.data() + noncontiguous_count );
+
+   // Merge from the back, in place.  Where bounds are equal the contiguous
+   // range goes first, and is the one kept when duplicates are dropped.
+   std::size_t merged_count = coalesced_count + noncontiguous_count;
+   std::size_t i = coalesced_count;
+   std::size_t j = noncontiguous_count;
+
+   while( j > 0 )
+   {
+      if( (i > 0) && (m_noncontiguous_ranges[j - 1] < m_ranges[i - 1]) )
+      {
+         m_ranges[i + j - 1] = m_ranges[i - 1];
+         i--;
+      }
+      else
+      {
+         m_ranges[i + j - 1] = m_noncontiguous_ranges[j - 1];
+         j--;
+      }
+   }
+
+   m_size = std::unique( m_ranges.data(), m_ranges.data() + merged_count ) - m_ranges.data();
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
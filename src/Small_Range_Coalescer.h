@@ -0,0 +1,85 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef SMALL_RANGE_COALESCER_H
+#define SMALL_RANGE_COALESCER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Coalesces up to capacity ranges held inline, with an insertion sort and a
+// linear merge instead of the general sort_and_coalesce() machinery.  Meant
+// for the handful of ranges typical of one table line; callers fall back to
+// the general path once push_back() reports the coalescer full.
+class Small_Range_Coalescer
+{
+   public:
+
+      static constexpr std::size_t capacity = 16;
+
+      Small_Range_Coalescer();
+
+      void clear();
+
+      // Returns false, leaving the ranges held unchanged, if already full.
+      bool push_back( const IP_Range & range );
+
+      // Sorts and coalesces the ranges held, with the same result as
+      // sort_and_coalesce() followed by dropping ranges whose bounds equal
+      // those of the range before, as inserting into an IP_Range_Set does.
+      void coalesce();
+
+      std::size_t size() const;
+
+      const IP_Range * begin() const;
+      const IP_Range * end() const;
+
+   private:
+
+      std::array<IP_Range, capacity> m_ranges;
+      std::size_t m_size;
+
+      // Scratch space for coalesce(), kept to save constructing it per call.
+      std::array<uint64_t, capacity> m_keys;
+      std::array<IP_Range, capacity> m_noncontiguous_ranges;
+};
+
+
+inline bool Small_Range_Coalescer::push_back( const IP_Range & range )
+{
+   if( m_size == capacity ) return false;
+
+   m_ranges[m_size++] = range;
+   return true;
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* SMALL_RANGE_COALESCER_H */
@@ -0,0 +1,221 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#include "Table_Line_Processor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+
+#include "Scan.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+Table_Line_Processor::Table_Line_Processor( bool is_cidr_only ) :
+   m_is_cidr_only( is_cidr_only )
+{
+}
+
+
+void Table_Line_Processor::process_lines( std::string_view lines, std::string & output )
+{
+   while( !lines.empty() )
+   {
+      std::size_t line_end = lines.find( '\n' );
+
+      process_line( lines.substr( 0, line_end ), output );
+      output += '\n';
+
+      lines.remove_prefix( (line_end == std::string_view::npos) ? lines.size() : line_end + 1 );
+   }
+}
+
+
+void Table_Line_Processor::process_line( std::string_view line, std::string & output )
+{
+   static constexpr char field_delim = ':';
+
+   m_statistics.input_lines++;
+
+   if( line.empty() )
+   {
+      m_statistics.stopped_on_parse_failure = true;
+      throw std::runtime_error( "Error parsing field 1" );
+   }
+
+   std::size_t field_1_end = line.find( field_delim );
+   std::string_view field_1 = line.substr( 0, field_1_end );
+
+   output += field_1;
+   output += field_delim;
+
+   // Field 2 is the first whitespace-delimited word after the delimiter.
+   std::string_view rest;
+   if( field_1_end != std::string_view::npos )
+   {
+      rest = line.substr( field_1_end + 1 );
+   }
+
+   std::size_t field_2_begin = 0;
+   while( (field_2_begin < rest.size()) && is_whitespace( rest[field_2_begin] ) )
+   {
+      field_2_begin++;
+   }
+
+   std::size_t field_2_end = field_2_begin;
+   while( (field_2_end < rest.size()) && !is_whitespace( rest[field_2_end] ) )
+   {
+      field_2_end++;
+   }
+
+   if( field_2_begin == field_2_end )
+   {
+      m_statistics.stopped_on_parse_failure = true;
+      throw std::runtime_error( "Error parsing field 2" );
+   }
+
+   process_field_2( rest.substr( field_2_begin, field_2_end - field_2_begin ), output );
+}
+
+
+const Run_Counters & Table_Line_Processor::get_statistics() const
+{
+   return m_statistics;
+}
+
+
+Run_Counters Table_Line_Processor::take_statistics()
+{
+   Run_Counters statistics = m_statistics;
+   m_statistics = Run_Counters();
+
+   return statistics;
+}
+
+
+void Table_Line_Processor::process_field_2( std::string_view field_2, std::string & output )
+{
+   static constexpr char item_delim = ',';
+
+   m_small_ranges.clear();
+   m_ranges.clear();
+   bool is_small = true;
+
+   // An empty item stands for a default-constructed range, and a trailing
+   // delimiter does not start another item.
+   while( !field_2.empty() )
+   {
+      std::size_t item_end = field_2.find( item_delim );
+      std::string_view item = field_2.substr( 0, item_end );
+
+      m_statistics.input_tokens++;
+
+      IP_Range range;
+      if( !item.empty() )
+      {
+         try
+         {
+            range.from_string( item );
+         }
+         catch( ... )
+         {
+            m_statistics.stopped_on_parse_failure = true;
+            throw;
+         }
+      }
+
+      m_statistics.ranges_inserted++;
+
+      if( is_small && !m_small_ranges.push_back( range ) )
+      {
+         m_ranges.assign( m_small_ranges.begin(), m_small_ranges.end() );
+         is_small = false;
+      }
+
+      if( !is_small )
+      {
+         m_ranges.push_back( range );
+      }
+
+      field_2.remove_prefix( (item_end == std::string_view::npos) ? field_2.size() : item_end + 1 );
+   }
+
+   const std::size_t range_count = is_small ? m_small_ranges.size() : m_ranges.size();
+
+   if( is_small )
+   {
+      m_small_ranges.coalesce();
+      m_statistics.merges += range_count - m_small_ranges.size();
+      append_ranges( m_small_ranges.begin(), m_small_ranges.end(), output );
+   }
+   else
+   {
+      // Coalescing leaves a range with a non-contiguous subnet mask next to a
+      // contiguous one with the same bounds; keep only the first, as
+      // inserting into an IP_Range_Set would.
+      sort_and_coalesce( m_ranges );
+      m_ranges.erase( std::unique( m_ranges.begin(), m_ranges.end() ), m_ranges.end() );
+      m_statistics.merges += range_count - m_ranges.size();
+
+      append_ranges( m_ranges.data(), m_ranges.data() + m_ranges.size(), output );
+   }
+}
+
+
+void Table_Line_Processor::append_ranges( const IP_Range * first, const IP_Range * last, std::string & output )
+{
+   static constexpr char item_delim = ',';
+
+   for( const IP_Range * iter = first; iter != last; iter++ )
+   {
+      m_statistics.count_output_range( *iter );
+   }
+
+   if( m_is_cidr_only )
+   {
+      m_cidr_blocks.clear();
+      for( const IP_Range * iter = first; iter != last; iter++ )
+      {
+         append_cidr_blocks( *iter, m_cidr_blocks );
+      }
+
+      first = m_cidr_blocks.data();
+      last = m_cidr_blocks.data() + m_cidr_blocks.size();
+   }
+
+   for( const IP_Range * iter = first; iter != last; iter++ )
+   {
+      if( iter != first )
+      {
+         output += item_delim;
+      }
+
+      char buffer[IP_Range::max_string_length];
+      output.append( buffer, m_is_cidr_only ? format_cidr_block( buffer, *iter ) : format_range( buffer, *iter ) );
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
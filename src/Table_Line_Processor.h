@@ -0,0 +1,85 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+
+#ifndef TABLE_LINE_PROCESSOR_H
+#define TABLE_LINE_PROCESSOR_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cfeyer/ip_coalesce/IP_Range.h>
+
+#include "Small_Range_Coalescer.h"
+#include "Run_Statistics.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+// Coalesces the ranges on "name:range,range,..." table lines.  Fields and
+// ranges are split as string_views of the line, and the ranges are coalesced
+// in a workspace kept from line to line, so once the workspace and output
+// have grown to fit, lines whose ranges all have contiguous subnet masks are
+// processed without touching the heap.  Lines of up to
+// Small_Range_Coalescer::capacity ranges are coalesced inline, and longer
+// ones with sort_and_coalesce().  Use one processor per thread.
+class Table_Line_Processor
+{
+   public:
+
+      // With is_cidr_only set, each coalesced range is written as the fewest
+      // CIDR blocks covering it, each in prefix form, and a range with a
+      // non-contiguous subnet mask throws std::invalid_argument.
+      explicit Table_Line_Processor( bool is_cidr_only = false );
+
+      // Appends "name:coalesced,ranges" for line to output.  Throws
+      // std::runtime_error if the line lacks either field.
+      void process_line( std::string_view line, std::string & output );
+
+      // Same for each line of a block of newline-separated lines, ending each
+      // in output with '\n'.
+      void process_lines( std::string_view lines, std::string & output );
+
+      // Lines, ranges and merges counted since construction or the last
+      // take_statistics(), which also resets them.  Each line's ranges are
+      // coalesced apart, so the final ranges are those of every line.
+      const Run_Counters & get_statistics() const;
+      Run_Counters take_statistics();
+
+   private:
+
+      void process_field_2( std::string_view field_2, std::string & output );
+      void append_ranges( const IP_Range * first, const IP_Range * last, std::string & output );
+
+      bool m_is_cidr_only;
+      Run_Counters m_statistics;
+
+      Small_Range_Coalescer m_small_ranges;
+      std::vector<IP_Range> m_ranges;
+      std::vector<IP_Range> m_cidr_blocks;
+};
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* TABLE_LINE_PROCESSOR_H */
@@ -0,0 +1,288 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "Workload_Generator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Format.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+namespace {
+
+constexpr uint32_t prefix_length_to_mask( int prefix_length )
+{
+   return prefix_length ? (0xffffffffu << (32 - prefix_length)) : 0;
+}
+
+
+bool is_ratio( double ratio )
+{
+   return (ratio >= 0.0) && (ratio <= 1.0);
+}
+
+} // namespace
+
+
+bool Workload_Generator::Generated_Range::operator < ( const Generated_Range & rhs ) const
+{
+   return (start_address < rhs.start_address) ||
+          ((start_address == rhs.start_address) && (end_address < rhs.end_address));
+}
+
+
+Workload_Generator::Workload_Generator( const Workload_Options & options ) :
+   m_options( options ),
+   m_total_prefix_length_weight( 0 ),
+   m_rng( options.seed )
+{
+   if( !is_ratio( options.overlap_ratio ) || !is_ratio( options.adjacency_ratio ) ||
+       !is_ratio( options.noncontiguous_ratio ) || !is_ratio( options.dash_range_ratio ) ||
+       !is_ratio( options.netmask_ratio ) || (options.overlap_ratio + options.adjacency_ratio > 1.0) )
+   {
+      throw std::invalid_argument( "Workload ratios must be between 0 and 1" );
+   }
+
+   for( const auto & weight : options.prefix_length_weights )
+   {
+      if( (weight.first < 0) || (weight.first > 32) )
+      {
+         throw std::invalid_argument( "Workload prefix lengths must be between 0 and 32" );
+      }
+      m_total_prefix_length_weight += weight.second;
+   }
+
+   if( m_total_prefix_length_weight == 0 )
+   {
+      throw std::invalid_argument( "Workload needs a prefix length with nonzero weight" );
+   }
+}
+
+
+// Slightly biased for bounds that do not divide 2^64, which is immaterial
+// here and keeps the sequence the same everywhere.
+uint64_t Workload_Generator::uniform( uint64_t bound )
+{
+   return m_rng() % bound;
+}
+
+
+double Workload_Generator::uniform_real()
+{
+   return (m_rng() >> 11) * 0x1.0p-53;
+}
+
+
+int Workload_Generator::random_prefix_length()
+{
+   uint64_t draw = uniform( m_total_prefix_length_weight );
+
+   for( const auto & weight : m_options.prefix_length_weights )
+   {
+      if( draw < weight.second ) return weight.first;
+      draw -= weight.second;
+   }
+
+   return m_options.prefix_length_weights.back().first;
+}
+
+
+Workload_Generator::Generated_Range Workload_Generator::generate_range()
+{
+   Generated_Range range;
+
+   if( uniform_real() < m_options.noncontiguous_ratio )
+   {
+      // A /24 netmask with one network bit cleared, as in 255.255.254.0 with
+      // a hole, keeps the pattern small.
+      range.noncontiguous_subnet_mask = 0xffffff00u & ~(1u << (8 + uniform( 24 )));
+      range.start_address = static_cast<uint32_t>(m_rng()) & range.noncontiguous_subnet_mask;
+      range.end_address = range.start_address | ~range.noncontiguous_subnet_mask;
+      range.syntax = Syntax::netmask;
+      return range;
+   }
+
+   range.noncontiguous_subnet_mask = 0;
+
+   const bool is_dash_range = (uniform_real() < m_options.dash_range_ratio);
+   int prefix_length = random_prefix_length();
+
+   const double placement = uniform_real();
+   const Generated_Range * earlier = m_history.empty() ? nullptr : &m_history[uniform( m_history.size() )];
+   uint32_t start_address = 0;
+
+   if( earlier && (placement < m_options.overlap_ratio) )
+   {
+      uint32_t address = earlier->start_address + uniform( uint64_t( earlier->end_address ) - earlier->start_address + 1 );
+      start_address = is_dash_range ? address : (address & prefix_length_to_mask( prefix_length ));
+   }
+   else if( earlier && (placement < m_options.overlap_ratio + m_options.adjacency_ratio) &&
+            (earlier->end_address != 0xffffffff) )
+   {
+      start_address = earlier->end_address + 1;
+
+      // Shrink the block until it is aligned at the address after the
+      // earlier range.
+      if( !is_dash_range )
+      {
+         prefix_length = std::max( prefix_length, 32 - __builtin_ctz( start_address ) );
+      }
+   }
+   else
+   {
+      start_address = static_cast<uint32_t>(m_rng());
+      if( !is_dash_range ) start_address &= prefix_length_to_mask( prefix_length );
+   }
+
+   const uint64_t block_size = uint64_t( 1 ) << (32 - prefix_length);
+   const uint64_t size = is_dash_range ? (1 + uniform( block_size )) : block_size;
+
+   range.start_address = start_address;
+   range.end_address = static_cast<uint32_t>(std::min<uint64_t>( start_address + size - 1, 0xffffffff ));
+
+   if( is_dash_range )
+   {
+      range.syntax = Syntax::dash;
+   }
+   else if( (prefix_length == 32) && (uniform_real() >= m_options.netmask_ratio) )
+   {
+      range.syntax = Syntax::address;
+   }
+   else
+   {
+      range.syntax = (uniform_real() < m_options.netmask_ratio) ? Syntax::netmask : Syntax::prefix_length;
+   }
+
+   if( m_history.size() < history_capacity )
+   {
+      m_history.push_back( range );
+   }
+   else
+   {
+      m_history[uniform( history_capacity )] = range;
+   }
+
+   return range;
+}
+
+
+void Workload_Generator::generate_ranges( std::size_t count, std::vector<Generated_Range> & ranges )
+{
+   ranges.clear();
+
+   for( std::size_t i = 0; i < count; i++ )
+   {
+      ranges.push_back( generate_range() );
+   }
+
+   switch( m_options.order )
+   {
+      case Workload_Options::Order::generated:
+         break;
+
+      case Workload_Options::Order::sorted:
+         std::sort( ranges.begin(), ranges.end() );
+         break;
+
+      case Workload_Options::Order::reverse_sorted:
+         std::sort( ranges.begin(), ranges.end() );
+         std::reverse( ranges.begin(), ranges.end() );
+         break;
+   }
+}
+
+
+void Workload_Generator::write_range( const Generated_Range & range, Range_Writer & writer )
+{
+   char buffer[2 * max_dotted_octet_length + 2];
+   char * out = format_dotted_octet( buffer, range.start_address );
+
+   const uint64_t size = uint64_t( range.end_address ) - range.start_address + 1;
+   const int prefix_length = 32 - (63 - __builtin_clzll( size ));
+
+   switch( range.syntax )
+   {
+      case Syntax::address:
+         break;
+
+      case Syntax::prefix_length:
+         *out++ = '/';
+         out = format_decimal( out, prefix_length );
+         break;
+
+      case Syntax::netmask:
+         *out++ = '/';
+         out = format_dotted_octet( out, range.noncontiguous_subnet_mask ? range.noncontiguous_subnet_mask
+                                                                        : prefix_length_to_mask( prefix_length ) );
+         break;
+
+      case Syntax::dash:
+         *out++ = '-';
+         out = format_dotted_octet( out, range.end_address );
+         break;
+   }
+
+   writer.write( std::string_view( buffer, out - buffer ) );
+}
+
+
+void Workload_Generator::write( Range_Writer & writer )
+{
+   std::vector<Generated_Range> ranges;
+
+   if( !m_options.is_table )
+   {
+      generate_ranges( m_options.count, ranges );
+
+      for( const Generated_Range & range : ranges )
+      {
+         write_range( range, writer );
+         writer.end_line();
+      }
+      return;
+   }
+
+   char key[24] = "row";
+
+   for( std::size_t line = 0; line < m_options.count; line++ )
+   {
+      m_history.clear();
+      generate_ranges( 1 + uniform( std::max<std::size_t>( m_options.max_ranges_per_line, 1 ) ), ranges );
+
+      writer.write( std::string_view( key, format_decimal( key + 3, static_cast<uint32_t>(line) ) - key ) );
+      writer.write( ':' );
+
+      for( std::size_t i = 0; i < ranges.size(); i++ )
+      {
+         if( i > 0 ) writer.write( ',' );
+         write_range( ranges[i], writer );
+      }
+
+      writer.end_line();
+   }
+}
+
+} // namespace ip_coalesce
+} // namespace cfeyer
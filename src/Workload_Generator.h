@@ -0,0 +1,124 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#ifndef WORKLOAD_GENERATOR_H
+#define WORKLOAD_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Range_Writer.h"
+
+namespace cfeyer {
+namespace ip_coalesce {
+
+struct Workload_Options
+{
+   enum class Order { generated, sorted, reverse_sorted };
+
+   uint64_t seed = 1;
+
+   // Ranges, or lines when is_table is set.
+   std::size_t count = 1000000;
+
+   // Relative weights of the prefix lengths of generated blocks, which also
+   // set the typical length of start-end ranges.
+   std::vector<std::pair<int, unsigned>> prefix_length_weights = { { 16, 1 }, { 20, 1 }, { 24, 4 }, { 28, 2 }, { 32, 8 } };
+
+   // Shares of ranges placed over an address of an earlier range, and right
+   // after the end of one; the rest are placed at random.
+   double overlap_ratio = 0.2;
+   double adjacency_ratio = 0.1;
+
+   // Shares of ranges with non-contiguous netmasks, of the rest written as
+   // start-end ranges, and of the remaining blocks written with a dotted
+   // netmask rather than a prefix length.  /32 blocks are otherwise written
+   // as plain addresses.
+   double noncontiguous_ratio = 0.01;
+   double dash_range_ratio = 0.1;
+   double netmask_ratio = 0.2;
+
+   Order order = Order::generated;
+
+   // Writes "rowN:range,range,..." lines of 1 to max_ranges_per_line ranges
+   // for ip-coalesce-table instead of one range a line.  Overlap and
+   // adjacency are then within each line.
+   bool is_table = false;
+   std::size_t max_ranges_per_line = 8;
+};
+
+
+// Writes synthetic range text in every syntax IP_Range::from_string()
+// accepts.  The output depends only on the options: random numbers are drawn
+// from std::mt19937_64 without the implementation-defined standard
+// distributions, so a seed gives the same text on every platform.
+class Workload_Generator
+{
+   public:
+
+      // Throws std::invalid_argument if a ratio is outside [0, 1], the
+      // overlap and adjacency ratios add up to more than 1, or there are no
+      // prefix length weights.
+      explicit Workload_Generator( const Workload_Options & options );
+
+      void write( Range_Writer & writer );
+
+   private:
+
+      enum class Syntax { address, prefix_length, netmask, dash };
+
+      struct Generated_Range
+      {
+         uint32_t start_address;
+         uint32_t end_address;
+         uint32_t noncontiguous_subnet_mask;
+         Syntax syntax;
+
+         bool operator < ( const Generated_Range & rhs ) const;
+      };
+
+      uint64_t uniform( uint64_t bound );
+      double uniform_real();
+      int random_prefix_length();
+
+      Generated_Range generate_range();
+      void generate_ranges( std::size_t count, std::vector<Generated_Range> & ranges );
+      void write_range( const Generated_Range & range, Range_Writer & writer );
+
+      Workload_Options m_options;
+      unsigned m_total_prefix_length_weight;
+
+      std::mt19937_64 m_rng;
+
+      // Contiguous ranges to overlap or follow, up to history_capacity of
+      // them sampled from those generated so far.
+      static constexpr std::size_t history_capacity = 4096;
+      std::vector<Generated_Range> m_history;
+};
+
+} // namespace ip_coalesce
+} // namespace cfeyer
+
+#endif /* WORKLOAD_GENERATOR_H */
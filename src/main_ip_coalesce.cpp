@@ -20,32 +20,753 @@
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //  THE SOFTWARE.
 
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
 #include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+#include <cfeyer/ip_coalesce/Range_Set_Algebra.h>
+#include <cfeyer/ip_coalesce/IP_Range_Snapshot.h>
+
+#include <unistd.h>
+
+#include "Range_Reader.h"
+#include "External_Coalescer.h"
+#include "Range_Writer.h"
+#include "Range_Delta.h"
+#include "Run_Statistics.h"
 
 using namespace cfeyer::ip_coalesce;
 
+
+enum class Set_Operator
+{
+   union_with,
+   intersect_with,
+   subtract,
+   complement
+};
+
+struct Set_Operation
+{
+   Set_Operator set_operator;
+   std::string operand_path;
+};
+
+struct Options
+{
+   unsigned thread_count = 1;
+   std::size_t max_memory_bytes = 0;
+   bool is_line_buffered = false;
+   bool is_cidr_only = false;
+   std::string input_path;
+   std::string snapshot_input_path;
+   std::string snapshot_output_path;
+   std::string delta_path;
+   bool is_changes_only = false;
+   bool is_stats = false;
+   std::vector<Set_Operation> set_operations;
+};
+
+using Range_Callback = std::function<void( const IP_Range & )>;
+
+bool parse_options( int argc, char * argv[], Options & options );
+bool parse_unsigned( const std::string & str, unsigned long long & value );
+bool parse_byte_count( const std::string & str, std::size_t & bytes );
+void print_usage( const char * program_name );
+
+int coalesce( const Options & options );
+std::unique_ptr<Range_Reader> open_input( const Options & options, std::size_t chunk_size );
+void count_tokens( const Range_Reader & reader, Run_Counters & counters );
+void read_all( Range_Reader & reader, std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges, Run_Counters & counters );
+void count_inserts( const Coalescing_IP_Range_Set & set, Run_Counters & counters );
+void coalesce_in_memory( const Options & options, const Range_Callback & output, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics );
+void coalesce_out_of_core( const Options & options, const Range_Callback & output, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics );
+void load_snapshot( const Options & options, const Range_Callback & output, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics );
+void update_incrementally( const Options & options, const Range_Callback & output, Range_Writer & writer, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics );
+void apply_set_operations( const Options & options, Coalescing_IP_Range_Set & set, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics );
+
+
 int main( int argc, char * argv[] )
 {
-   Coalescing_IP_Range_Set set;
+   Options options;
 
-   IP_Range range;
+   if( !parse_options( argc, argv, options ) )
+   {
+      print_usage( argv[0] );
+      return 1;
+   }
 
-   while( std::cin >> range )
+   try
+   {
+      return coalesce( options );
+   }
+   catch( const std::exception & e )
    {
-      set.insert( range );
+      std::cerr << argv[0] << ": " << e.what() << '\n';
+      return 1;
    }
+}
+
+
+int coalesce( const Options & options )
+{
+   Range_Writer writer( STDOUT_FILENO, options.is_line_buffered );
 
    bool needs_preceeding_delimiter = false;
-   for( auto range : set )
+   auto write_delimiter = [&]()
    {
-      std::cout << (needs_preceeding_delimiter ? " " : "")
-                << range;
+      if( needs_preceeding_delimiter )
+      {
+         writer.write( ' ' );
+      }
       needs_preceeding_delimiter = true;
+   };
+
+   auto output_range = [&]( const auto & range, auto & cidr_blocks )
+   {
+      if( options.is_cidr_only )
+      {
+         cidr_blocks.clear();
+         append_cidr_blocks( range, cidr_blocks );
+
+         for( const auto & block : cidr_blocks )
+         {
+            write_delimiter();
+            writer.write_cidr_block( block );
+         }
+      }
+      else
+      {
+         write_delimiter();
+         writer.write( range );
+      }
+
+      // Output is a single line, so line buffering hands over each range
+      // as soon as it is known.
+      if( options.is_line_buffered )
+      {
+         writer.flush();
+      }
+   };
+
+   std::vector<IP_Range> cidr_blocks;
+   std::unique_ptr<Snapshot_Writer> snapshot_writer;
+   Range_Callback output;
+
+   if( options.snapshot_output_path.empty() )
+   {
+      output = [&]( const IP_Range & range ) { output_range( range, cidr_blocks ); };
+   }
+   else
+   {
+      snapshot_writer.reset( new Snapshot_Writer( options.snapshot_output_path ) );
+      output = [&]( const IP_Range & range ) { snapshot_writer->add( range ); };
+   }
+
+   Run_Statistics statistics( options.is_stats );
+
+   if( statistics.is_enabled() )
+   {
+      output = [&statistics, write_output = std::move(output)]( const IP_Range & range )
+      {
+         statistics.counters().count_output_range( range );
+         write_output( range );
+      };
    }
 
+   std::vector<IP6_Range> ip6_ranges;
+
+   try
+   {
+      if( !options.delta_path.empty() )
+      {
+         update_incrementally( options, output, writer, ip6_ranges, statistics );
+      }
+      else if( !options.snapshot_input_path.empty() )
+      {
+         load_snapshot( options, output, ip6_ranges, statistics );
+      }
+      else if( options.max_memory_bytes > 0 )
+      {
+         coalesce_out_of_core( options, output, ip6_ranges, statistics );
+      }
+      else
+      {
+         coalesce_in_memory( options, output, ip6_ranges, statistics );
+      }
+
+      if( snapshot_writer )
+      {
+         if( !ip6_ranges.empty() )
+         {
+            throw std::runtime_error( "IPv6 ranges cannot be saved in a snapshot." );
+         }
+
+         snapshot_writer->finish();
+      }
+      else
+      {
+         // IPv6 ranges follow the IPv4 ones, sorted among themselves.
+         const std::size_t ip6_range_count = ip6_ranges.size();
+         sort_and_coalesce( ip6_ranges );
+
+         statistics.counters().ranges_inserted += ip6_range_count;
+         statistics.counters().merges += ip6_range_count - ip6_ranges.size();
+
+         std::vector<IP6_Range> ip6_cidr_blocks;
+         for( const IP6_Range & range : ip6_ranges )
+         {
+            statistics.counters().count_output_range( range );
+            output_range( range, ip6_cidr_blocks );
+         }
+
+         writer.flush();
+      }
+   }
+   catch( ... )
+   {
+      statistics.end_phase();
+      statistics.print( std::cerr );
+      throw;
+   }
+
+   statistics.end_phase();
+   statistics.print( std::cerr );
+
    return 0;
 }
 
+
+std::unique_ptr<Range_Reader> open_input( const Options & options, std::size_t chunk_size )
+{
+   if( options.input_path.empty() )
+   {
+      return std::unique_ptr<Range_Reader>( new Range_Reader( STDIN_FILENO, chunk_size ) );
+   }
+   else
+   {
+      return std::unique_ptr<Range_Reader>( new Range_Reader( options.input_path, chunk_size ) );
+   }
+}
+
+
+// Adds the tokens read, counting one that failed to parse.
+void count_tokens( const Range_Reader & reader, Run_Counters & counters )
+{
+   const Range_Reader::Statistics & reader_statistics = reader.get_statistics();
+
+   counters.input_tokens += reader_statistics.tokens_parsed + (reader_statistics.stopped_on_parse_failure ? 1 : 0);
+   counters.stopped_on_parse_failure = counters.stopped_on_parse_failure || reader_statistics.stopped_on_parse_failure;
+}
+
+
+// Reads the rest of the input, adding the reader's counts to counters even
+// when a token fails to parse.
+void read_all( Range_Reader & reader, std::vector<IP_Range> & ranges, std::vector<IP6_Range> & ip6_ranges, Run_Counters & counters )
+{
+   try
+   {
+      reader.read_all( ranges, ip6_ranges );
+   }
+   catch( ... )
+   {
+      count_tokens( reader, counters );
+      throw;
+   }
+
+   count_tokens( reader, counters );
+}
+
+
+void count_inserts( const Coalescing_IP_Range_Set & set, Run_Counters & counters )
+{
+   counters.ranges_inserted += set.get_statistics().ranges_inserted;
+   counters.merges += set.get_statistics().merges;
+}
+
+
+void coalesce_in_memory( const Options & options, const Range_Callback & output, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics )
+{
+   std::vector<IP_Range> ranges;
+
+   statistics.begin_phase( "read" );
+   read_all( *open_input( options, Range_Reader::default_chunk_size ), ranges, ip6_ranges, statistics.counters() );
+
+   statistics.begin_phase( "coalesce" );
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges), options.thread_count );
+   count_inserts( set, statistics.counters() );
+
+   apply_set_operations( options, set, ip6_ranges, statistics );
+
+   statistics.begin_phase( "output" );
+   for( const IP_Range & range : set )
+   {
+      output( range );
+   }
+}
+
+
+// Only the IPv4 ranges are held to the memory budget; IPv6 ranges are
+// gathered in ip6_ranges and coalesced in memory.
+void coalesce_out_of_core( const Options & options, const Range_Callback & output, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics )
+{
+   External_Coalescer coalescer( options.max_memory_bytes, options.thread_count );
+
+   std::unique_ptr<Range_Reader> reader = open_input( options, coalescer.input_chunk_size() );
+   std::vector<IP_Range> ranges;
+   uint64_t inserted_count = 0;
+
+   // Sorted runs are spilled as the input is read, and merged as they are
+   // written.
+   statistics.begin_phase( "read and sort runs" );
+
+   try
+   {
+      while( reader->read_chunk( ranges, ip6_ranges ) )
+      {
+         // Only IPv4 runs are spilled, so IPv6 input would grow without
+         // bound in memory; refuse it rather than exceed the limit.
+         if( !ip6_ranges.empty() )
+         {
+            throw std::runtime_error( "IPv6 range '" + to_string( ip6_ranges.front() ) +
+                                      "' in input; --max-memory handles IPv4 only." );
+         }
+
+         inserted_count += ranges.size();
+         coalescer.insert( ranges.begin(), ranges.end() );
+         ranges.clear();
+      }
+   }
+   catch( ... )
+   {
+      count_tokens( *reader, statistics.counters() );
+      throw;
+   }
+
+   count_tokens( *reader, statistics.counters() );
+
+   statistics.begin_phase( "merge and output" );
+
+   uint64_t output_count = 0;
+   coalescer.finish( [&]( const IP_Range & range )
+   {
+      output_count++;
+      output( range );
+   } );
+
+   statistics.counters().ranges_inserted += inserted_count;
+   statistics.counters().merges += inserted_count - output_count;
+}
+
+
+// A snapshot is already coalesced, so without set operations its ranges go
+// straight from the mapping to the output.
+void load_snapshot( const Options & options, const Range_Callback & output, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics )
+{
+   statistics.begin_phase( "load snapshot" );
+   IP_Range_Snapshot snapshot( options.snapshot_input_path );
+
+   if( options.set_operations.empty() )
+   {
+      statistics.begin_phase( "output" );
+      snapshot.for_each( output );
+      return;
+   }
+
+   Coalescing_IP_Range_Set set = snapshot.to_set();
+
+   apply_set_operations( options, set, ip6_ranges, statistics );
+
+   statistics.begin_phase( "output" );
+   for( const IP_Range & range : set )
+   {
+      output( range );
+   }
+}
+
+
+// Writes each range, or its CIDR blocks, on its own line after sign.
+template< typename Range >
+void write_changes( Range_Writer & writer, char sign, const std::vector<Range> & ranges, bool is_cidr_only )
+{
+   std::vector<Range> blocks;
+
+   for( const Range & range : ranges )
+   {
+      blocks.clear();
+
+      if( is_cidr_only )
+      {
+         append_cidr_blocks( range, blocks );
+      }
+      else
+      {
+         blocks.push_back( range );
+      }
+
+      for( const Range & block : blocks )
+      {
+         writer.write( sign );
+
+         if( is_cidr_only )
+         {
+            writer.write_cidr_block( block );
+         }
+         else
+         {
+            writer.write( block );
+         }
+
+         writer.end_line();
+      }
+   }
+}
+
+
+// Loads the previous result, from a snapshot or as text, and applies the
+// +RANGE and -RANGE changes of the delta file to it instead of coalescing
+// everything again.  With --changes-only, writes the net change to the result
+// as a delta of its own, found by comparing the result before and after within
+// the ranges the delta touches.
+void update_incrementally( const Options & options, const Range_Callback & output, Range_Writer & writer, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics )
+{
+   Coalescing_IP_Range_Set set;
+
+   if( !options.snapshot_input_path.empty() )
+   {
+      statistics.begin_phase( "load snapshot" );
+      set = IP_Range_Snapshot( options.snapshot_input_path ).to_set();
+   }
+   else
+   {
+      std::vector<IP_Range> ranges;
+
+      statistics.begin_phase( "read" );
+      read_all( *open_input( options, Range_Reader::default_chunk_size ), ranges, ip6_ranges, statistics.counters() );
+
+      statistics.begin_phase( "coalesce" );
+      set = Coalescing_IP_Range_Set::build( std::move(ranges), options.thread_count );
+   }
+
+   sort_and_coalesce( ip6_ranges );
+
+   statistics.begin_phase( "apply delta" );
+
+   std::ifstream delta_file( options.delta_path );
+   if( !delta_file )
+   {
+      throw std::runtime_error( "Failed to open '" + options.delta_path + "'" );
+   }
+
+   const std::string delta_text( (std::istreambuf_iterator<char>( delta_file )), std::istreambuf_iterator<char>() );
+
+   std::vector<Range_Change> changes;
+   std::vector<IP6_Range_Change> ip6_changes;
+   parse_range_changes( delta_text, changes, ip6_changes );
+
+   if( !options.is_changes_only )
+   {
+      apply_range_changes( changes, set );
+      apply_range_changes( ip6_changes, ip6_ranges );
+      count_inserts( set, statistics.counters() );
+
+      apply_set_operations( options, set, ip6_ranges, statistics );
+
+      statistics.begin_phase( "output" );
+      for( const IP_Range & range : set )
+      {
+         output( range );
+      }
+      return;
+   }
+
+   std::vector<IP_Range> touched_ranges;
+   std::vector<IP6_Range> ip6_touched_ranges;
+
+   for( const Range_Change & change : changes ) touched_ranges.push_back( change.range );
+   for( const IP6_Range_Change & change : ip6_changes ) ip6_touched_ranges.push_back( change.range );
+
+   const Coalescing_IP_Range_Set touched = Coalescing_IP_Range_Set::build( std::move(touched_ranges) );
+   sort_and_coalesce( ip6_touched_ranges );
+
+   const Coalescing_IP_Range_Set before = set_intersection( set, touched );
+   std::vector<IP6_Range> ip6_before;
+   append_intersection( ip6_ranges, ip6_touched_ranges, ip6_before );
+
+   apply_range_changes( changes, set );
+   apply_range_changes( ip6_changes, ip6_ranges );
+   count_inserts( set, statistics.counters() );
+
+   const Coalescing_IP_Range_Set after = set_intersection( set, touched );
+   std::vector<IP6_Range> ip6_after;
+   append_intersection( ip6_ranges, ip6_touched_ranges, ip6_after );
+
+   const Coalescing_IP_Range_Set added = set_difference( after, before );
+   const Coalescing_IP_Range_Set removed = set_difference( before, after );
+   std::vector<IP6_Range> ip6_added, ip6_removed;
+   append_difference( ip6_after, ip6_before, ip6_added );
+   append_difference( ip6_before, ip6_after, ip6_removed );
+
+   statistics.begin_phase( "output" );
+   write_changes( writer, '+', std::vector<IP_Range>( added.begin(), added.end() ), options.is_cidr_only );
+   write_changes( writer, '-', std::vector<IP_Range>( removed.begin(), removed.end() ), options.is_cidr_only );
+   write_changes( writer, '+', ip6_added, options.is_cidr_only );
+   write_changes( writer, '-', ip6_removed, options.is_cidr_only );
+
+   ip6_ranges.clear();
+}
+
+
+// Applies each set operation in turn to the coalesced input, reading and
+// coalescing its operand file first.  --complement takes the IPv6 complement
+// too once any IPv6 range has been read, so IPv4-only input stays IPv4-only.
+void apply_set_operations( const Options & options, Coalescing_IP_Range_Set & set, std::vector<IP6_Range> & ip6_ranges, Run_Statistics & statistics )
+{
+   if( options.set_operations.empty() ) return;
+
+   statistics.begin_phase( "set operations" );
+
+   bool has_ip6_ranges = !ip6_ranges.empty();
+   sort_and_coalesce( ip6_ranges );
+
+   for( const Set_Operation & operation : options.set_operations )
+   {
+      Coalescing_IP_Range_Set operand;
+      std::vector<IP6_Range> ip6_operand;
+
+      if( operation.set_operator != Set_Operator::complement )
+      {
+         std::vector<IP_Range> ranges;
+         Range_Reader reader( operation.operand_path );
+         read_all( reader, ranges, ip6_operand, statistics.counters() );
+
+         operand = Coalescing_IP_Range_Set::build( std::move(ranges), options.thread_count );
+         sort_and_coalesce( ip6_operand );
+         has_ip6_ranges = has_ip6_ranges || !ip6_operand.empty();
+      }
+
+      std::vector<IP6_Range> ip6_result;
+
+      switch( operation.set_operator )
+      {
+         case Set_Operator::union_with:
+            set = set_union( set, operand );
+            append_union( ip6_ranges, ip6_operand, ip6_result );
+            break;
+
+         case Set_Operator::intersect_with:
+            set = set_intersection( set, operand );
+            append_intersection( ip6_ranges, ip6_operand, ip6_result );
+            break;
+
+         case Set_Operator::subtract:
+            set = set_difference( set, operand );
+            append_difference( ip6_ranges, ip6_operand, ip6_result );
+            break;
+
+         case Set_Operator::complement:
+            set = complement( set );
+            if( has_ip6_ranges )
+            {
+               append_complement( ip6_ranges, ip6_result );
+            }
+            break;
+      }
+
+      ip6_ranges.swap( ip6_result );
+   }
+}
+
+
+bool parse_options( int argc, char * argv[], Options & options )
+{
+   for( int i = 1; i < argc; i++ )
+   {
+      const std::string arg = argv[i];
+
+      if( (arg == "--threads") && (i + 1 < argc) )
+      {
+         unsigned long long thread_count = 0;
+         if( !parse_unsigned( argv[++i], thread_count ) ) return false;
+         if( thread_count > std::numeric_limits<unsigned>::max() ) return false;
+         options.thread_count = static_cast<unsigned>(thread_count);
+      }
+      else if( (arg == "--max-memory") && (i + 1 < argc) )
+      {
+         if( !parse_byte_count( argv[++i], options.max_memory_bytes ) ) return false;
+         if( options.max_memory_bytes == 0 ) return false;
+      }
+      else if( (arg == "--union") && (i + 1 < argc) )
+      {
+         options.set_operations.push_back( { Set_Operator::union_with, argv[++i] } );
+      }
+      else if( (arg == "--intersect") && (i + 1 < argc) )
+      {
+         options.set_operations.push_back( { Set_Operator::intersect_with, argv[++i] } );
+      }
+      else if( (arg == "--subtract") && (i + 1 < argc) )
+      {
+         options.set_operations.push_back( { Set_Operator::subtract, argv[++i] } );
+      }
+      else if( arg == "--complement" )
+      {
+         options.set_operations.push_back( { Set_Operator::complement, std::string() } );
+      }
+      else if( (arg == "--load-binary") && (i + 1 < argc) )
+      {
+         options.snapshot_input_path = argv[++i];
+      }
+      else if( (arg == "--save-binary") && (i + 1 < argc) )
+      {
+         options.snapshot_output_path = argv[++i];
+      }
+      else if( (arg == "--apply-delta") && (i + 1 < argc) )
+      {
+         options.delta_path = argv[++i];
+      }
+      else if( arg == "--changes-only" )
+      {
+         options.is_changes_only = true;
+      }
+      else if( arg == "--cidr-only" )
+      {
+         options.is_cidr_only = true;
+      }
+      else if( arg == "--line-buffered" )
+      {
+         options.is_line_buffered = true;
+      }
+      else if( arg == "--stats" )
+      {
+         options.is_stats = true;
+      }
+      else if( options.input_path.empty() && !arg.empty() && (arg[0] != '-') )
+      {
+         options.input_path = arg;
+      }
+      else
+      {
+         return false;
+      }
+   }
+
+   // Set operations work on the whole coalesced input in memory.
+   if( !options.set_operations.empty() && (options.max_memory_bytes > 0) )
+   {
+      return false;
+   }
+
+   // A snapshot replaces the text input, and is already coalesced.
+   if( !options.snapshot_input_path.empty() &&
+       (!options.input_path.empty() || (options.max_memory_bytes > 0)) )
+   {
+      return false;
+   }
+
+   // Deltas apply to the previous result in memory; only the change itself is
+   // written with --changes-only.
+   if( !options.delta_path.empty() && (options.max_memory_bytes > 0) )
+   {
+      return false;
+   }
+
+   if( options.is_changes_only &&
+       (options.delta_path.empty() || !options.set_operations.empty() || !options.snapshot_output_path.empty()) )
+   {
+      return false;
+   }
+
+   // A snapshot holds the ranges themselves, not their text form.
+   if( !options.snapshot_output_path.empty() && options.is_cidr_only )
+   {
+      return false;
+   }
+
+   return true;
+}
+
+
+// Fails, rather than throwing, on values too large for value.
+bool parse_unsigned( const std::string & str, unsigned long long & value )
+{
+   if( str.empty() || (str.find_first_not_of( "0123456789" ) != std::string::npos) )
+   {
+      return false;
+   }
+
+   errno = 0;
+   value = std::strtoull( str.c_str(), nullptr, 10 );
+   return (errno != ERANGE);
+}
+
+
+// Accepts a byte count with an optional K, M or G (binary) suffix, failing
+// if it does not fit in a std::size_t.
+bool parse_byte_count( const std::string & str, std::size_t & bytes )
+{
+   if( str.empty() ) return false;
+
+   unsigned long long multiplier = 1;
+   std::string digits = str;
+
+   switch( str.back() )
+   {
+      case 'K': case 'k': multiplier = 1ull << 10; digits.pop_back(); break;
+      case 'M': case 'm': multiplier = 1ull << 20; digits.pop_back(); break;
+      case 'G': case 'g': multiplier = 1ull << 30; digits.pop_back(); break;
+   }
+
+   unsigned long long value = 0;
+   if( !parse_unsigned( digits, value ) ) return false;
+   if( value > std::numeric_limits<std::size_t>::max() / multiplier ) return false;
+
+   bytes = value * multiplier;
+   return true;
+}
+
+
+void print_usage( const char * program_name )
+{
+   std::cerr << "Usage: " << program_name << " [--threads N] [--max-memory SIZE] [--cidr-only] [--line-buffered]\n"
+             << "       [--stats]\n"
+             << "       [--union FILE2] [--intersect FILE2] [--subtract FILE2] [--complement]\n"
+             << "       [--save-binary SNAP] [--apply-delta DELTA [--changes-only]]\n"
+             << "       [--load-binary SNAP | FILE]\n"
+             << "Coalesces the IPv4 and IPv6 ranges in FILE, or standard input if none is\n"
+             << "given, writing the IPv4 ranges first.\n"
+             << "  --threads N         coalesce on N threads (0 = one per core)\n"
+             << "  --max-memory SIZE   keep working memory under SIZE bytes (K, M or G suffix\n"
+             << "                      allowed), spilling sorted runs to $TMPDIR as needed;\n"
+             << "                      IPv4 input only\n"
+             << "  --cidr-only         write each range as the fewest CIDR blocks covering it,\n"
+             << "                      all as ADDRESS/PREFIX; ranges with non-contiguous\n"
+             << "                      netmasks are an error\n"
+             << "  --line-buffered     write each range out as soon as it is produced\n"
+             << "  --stats             write counts, phase timings and peak memory use to\n"
+             << "                      standard error when done\n"
+             << "  --union FILE2       add the ranges in FILE2\n"
+             << "  --intersect FILE2   keep only addresses also in FILE2\n"
+             << "  --subtract FILE2    remove the addresses in FILE2\n"
+             << "  --complement        take every address not in the ranges\n"
+             << "  --save-binary SNAP  write the IPv4 result to SNAP as a binary snapshot\n"
+             << "                      instead of as text\n"
+             << "  --load-binary SNAP  read a binary snapshot in place of FILE\n"
+             << "  --apply-delta DELTA\n"
+             << "                      apply the +RANGE and -RANGE changes in DELTA, in order,\n"
+             << "                      to a previous result instead of coalescing it again\n"
+             << "  --changes-only      with --apply-delta, write only the ranges added to and\n"
+             << "                      removed from the result, one +RANGE or -RANGE a line\n"
+             << "Set operations apply in the order given and cannot be combined with\n"
+             << "--max-memory.\n";
+}
@@ -0,0 +1,212 @@
+//  The MIT License
+//  
+//  Copyright (c) 2018 Chris Feyerchak
+//  
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "Range_Writer.h"
+#include "Workload_Generator.h"
+
+using namespace cfeyer::ip_coalesce;
+
+
+bool parse_options( int argc, char * argv[], Workload_Options & options );
+bool parse_unsigned( const std::string & str, unsigned long long & value );
+bool parse_ratio( const std::string & str, double & ratio );
+bool parse_prefix_length_weights( const std::string & str, Workload_Options & options );
+void print_usage( const char * program_name );
+
+
+int main( int argc, char * argv[] )
+{
+   Workload_Options options;
+
+   if( !parse_options( argc, argv, options ) )
+   {
+      print_usage( argv[0] );
+      return 1;
+   }
+
+   Range_Writer writer( STDOUT_FILENO );
+   Workload_Generator( options ).write( writer );
+   writer.flush();
+
+   return 0;
+}
+
+
+bool parse_options( int argc, char * argv[], Workload_Options & options )
+{
+   for( int i = 1; i < argc; i++ )
+   {
+      const std::string arg = argv[i];
+      const bool has_value = (i + 1 < argc);
+      unsigned long long value = 0;
+
+      if( (arg == "--seed") && has_value )
+      {
+         if( !parse_unsigned( argv[++i], value ) ) return false;
+         options.seed = value;
+      }
+      else if( (arg == "--count") && has_value )
+      {
+         if( !parse_unsigned( argv[++i], value ) ) return false;
+         options.count = value;
+      }
+      else if( (arg == "--prefix-lengths") && has_value )
+      {
+         if( !parse_prefix_length_weights( argv[++i], options ) ) return false;
+      }
+      else if( (arg == "--overlap") && has_value )
+      {
+         if( !parse_ratio( argv[++i], options.overlap_ratio ) ) return false;
+      }
+      else if( (arg == "--adjacency") && has_value )
+      {
+         if( !parse_ratio( argv[++i], options.adjacency_ratio ) ) return false;
+      }
+      else if( (arg == "--noncontiguous") && has_value )
+      {
+         if( !parse_ratio( argv[++i], options.noncontiguous_ratio ) ) return false;
+      }
+      else if( (arg == "--dash-ranges") && has_value )
+      {
+         if( !parse_ratio( argv[++i], options.dash_range_ratio ) ) return false;
+      }
+      else if( (arg == "--netmasks") && has_value )
+      {
+         if( !parse_ratio( argv[++i], options.netmask_ratio ) ) return false;
+      }
+      else if( (arg == "--order") && has_value )
+      {
+         const std::string order = argv[++i];
+
+         if( order == "generated" ) options.order = Workload_Options::Order::generated;
+         else if( order == "sorted" ) options.order = Workload_Options::Order::sorted;
+         else if( order == "reverse" ) options.order = Workload_Options::Order::reverse_sorted;
+         else return false;
+      }
+      else if( arg == "--table" )
+      {
+         options.is_table = true;
+      }
+      else if( (arg == "--ranges-per-line") && has_value )
+      {
+         if( !parse_unsigned( argv[++i], value ) || (value == 0) ) return false;
+         options.max_ranges_per_line = value;
+      }
+      else
+      {
+         return false;
+      }
+   }
+
+   return (options.overlap_ratio + options.adjacency_ratio <= 1.0);
+}
+
+
+// Fails, rather than throwing, on values too large for value.
+bool parse_unsigned( const std::string & str, unsigned long long & value )
+{
+   if( str.empty() || (str.find_first_not_of( "0123456789" ) != std::string::npos) )
+   {
+      return false;
+   }
+
+   errno = 0;
+   value = std::strtoull( str.c_str(), nullptr, 10 );
+   return (errno != ERANGE);
+}
+
+
+bool parse_ratio( const std::string & str, double & ratio )
+{
+   char * end = nullptr;
+   ratio = std::strtod( str.c_str(), &end );
+
+   return !str.empty() && (*end == '\0') && (ratio >= 0.0) && (ratio <= 1.0);
+}
+
+
+// Parses comma-separated LENGTH:WEIGHT pairs, as in "24:4,32:8".
+bool parse_prefix_length_weights( const std::string & str, Workload_Options & options )
+{
+   options.prefix_length_weights.clear();
+
+   std::size_t begin = 0;
+
+   while( begin <= str.size() )
+   {
+      std::size_t end = str.find( ',', begin );
+      if( end == std::string::npos ) end = str.size();
+
+      const std::string pair = str.substr( begin, end - begin );
+      const std::size_t colon = pair.find( ':' );
+      unsigned long long length = 0;
+      unsigned long long weight = 0;
+
+      if( (colon == std::string::npos) ||
+          !parse_unsigned( pair.substr( 0, colon ), length ) || (length > 32) ||
+          !parse_unsigned( pair.substr( colon + 1 ), weight ) || (weight > 1000000) )
+      {
+         return false;
+      }
+
+      options.prefix_length_weights.push_back( { static_cast<int>(length), static_cast<unsigned>(weight) } );
+      begin = end + 1;
+   }
+
+   unsigned long long total_weight = 0;
+   for( const auto & weight : options.prefix_length_weights ) total_weight += weight.second;
+
+   return total_weight > 0;
+}
+
+
+void print_usage( const char * program_name )
+{
+   const Workload_Options defaults;
+
+   std::cerr << "Usage: " << program_name << " [--seed N] [--count N] [--prefix-lengths LEN:WEIGHT,...]\n"
+             << "       [--overlap R] [--adjacency R] [--noncontiguous R] [--dash-ranges R]\n"
+             << "       [--netmasks R] [--order generated|sorted|reverse]\n"
+             << "       [--table [--ranges-per-line N]]\n"
+             << "Writes reproducible synthetic IP range text, one range a line, for\n"
+             << "benchmarks and stress tests.  The same options give the same output.\n"
+             << "  --seed N            random seed (default " << defaults.seed << ")\n"
+             << "  --count N           ranges, or lines with --table (default " << defaults.count << ")\n"
+             << "  --prefix-lengths L  relative weights of block prefix lengths\n"
+             << "                      (default 16:1,20:1,24:4,28:2,32:8)\n"
+             << "  --overlap R         share placed over an earlier range (default " << defaults.overlap_ratio << ")\n"
+             << "  --adjacency R       share placed right after an earlier one (default " << defaults.adjacency_ratio << ")\n"
+             << "  --noncontiguous R   share with non-contiguous netmasks (default " << defaults.noncontiguous_ratio << ")\n"
+             << "  --dash-ranges R     share of the rest written start-end (default " << defaults.dash_range_ratio << ")\n"
+             << "  --netmasks R        share of blocks with a dotted netmask (default " << defaults.netmask_ratio << ")\n"
+             << "  --order ORDER       generated (default), sorted or reverse sorted order\n"
+             << "  --table             write ip-coalesce-table \"rowN:range,...\" lines\n"
+             << "  --ranges-per-line N\n"
+             << "                      up to N ranges a table line (default " << defaults.max_ranges_per_line << ")\n";
+}
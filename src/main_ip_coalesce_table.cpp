@@ -20,91 +20,164 @@
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //  THE SOFTWARE.
 
+#include <exception>
 #include <iostream>
+#include <mutex>
 #include <string>
-#include <sstream>
-#include <stdexcept>
+#include <string_view>
 
-#include <cfeyer/ip_coalesce/IP_Range.h>
-#include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+#include <unistd.h>
+
+#include "Range_Writer.h"
+#include "Ordered_Line_Pipeline.h"
+#include "Table_Line_Processor.h"
+#include "Run_Statistics.h"
 
 using namespace cfeyer::ip_coalesce;
 
 
-void process_line( const std::string & line );
-void process_field_2( const std::string & field_2 );
+bool parse_unsigned( const std::string & str, unsigned & value );
 
 
 int main( int argc, char * argv[] )
 {
-   std::string line;
+   bool is_line_buffered = false;
+   bool is_cidr_only = false;
+   bool is_stats = false;
+   unsigned thread_count = 1;
 
-   while( std::getline( std::cin, line ) )
+   for( int i = 1; i < argc; i++ )
    {
-      process_line( line );
-   }
+      const std::string arg = argv[i];
 
-   std::cout.flush();
+      if( arg == "--cidr-only" )
+      {
+         is_cidr_only = true;
+      }
+      else if( arg == "--line-buffered" )
+      {
+         is_line_buffered = true;
+      }
+      else if( arg == "--stats" )
+      {
+         is_stats = true;
+      }
+      else if( (arg == "--threads") && (i + 1 < argc) && parse_unsigned( argv[i+1], thread_count ) )
+      {
+         i++;
+      }
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--threads N] [--cidr-only] [--line-buffered] [--stats]\n"
+                   << "  --threads N       process lines on N threads (0 = one per core),\n"
+                   << "                    writing results in input order\n"
+                   << "  --cidr-only       write each range as the fewest CIDR blocks covering it,\n"
+                   << "                    all as ADDRESS/PREFIX; ranges with non-contiguous\n"
+                   << "                    netmasks are an error\n"
+                   << "  --line-buffered   write each line out as soon as it is produced\n"
+                   << "  --stats           write counts, timings and peak memory use to standard\n"
+                   << "                    error when done\n";
+         return 1;
+      }
+   }
 
-   return 0;
-}
+   Range_Writer writer( STDOUT_FILENO, is_line_buffered );
+   Run_Statistics statistics( is_stats );
+   std::mutex statistics_mutex;
 
+   // Adds in a processor's counts since the last call, once a block of lines.
+   auto add_statistics = [&]( Table_Line_Processor & processor )
+   {
+      if( !is_stats ) return;
 
-void process_line( const std::string & line )
-{
-   std::istringstream line_strm( line );
+      std::lock_guard<std::mutex> lock( statistics_mutex );
+      statistics.counters() += processor.take_statistics();
+   };
 
-   static constexpr char field_delim = ':';
+   // Lines are read, coalesced and written in turn, so that is one phase.
+   statistics.begin_phase( "process lines" );
 
-   std::string field_1;
-   if( std::getline( line_strm, field_1, field_delim ) )
+   try
    {
-      std::cout << field_1 << field_delim;
-   }
-   else
-   {
-      throw std::runtime_error( "Error parsing field 1" );
-   }
-   
-   std::string field_2;
-   if( line_strm >> field_2 )
-   {
-      process_field_2( field_2 );
+      if( thread_count == 1 )
+      {
+         std::ios::sync_with_stdio( false );
+
+         Table_Line_Processor processor( is_cidr_only );
+         std::string line;
+         std::string output;
+
+         try
+         {
+            while( std::getline( std::cin, line ) )
+            {
+               output.clear();
+               processor.process_line( line, output );
+               writer.write( output );
+               writer.end_line();
+            }
+         }
+         catch( ... )
+         {
+            add_statistics( processor );
+            throw;
+         }
+
+         add_statistics( processor );
+      }
+      else
+      {
+         auto process_lines = [=, &add_statistics]( std::string_view lines, std::string & output )
+         {
+            thread_local Table_Line_Processor processor( is_cidr_only );
+
+            try
+            {
+               processor.process_lines( lines, output );
+            }
+            catch( ... )
+            {
+               add_statistics( processor );
+               throw;
+            }
+
+            add_statistics( processor );
+         };
+
+         Ordered_Line_Pipeline pipeline( thread_count, process_lines,
+            [&]( std::string_view output )
+            {
+               writer.write( output );
+               if( is_line_buffered ) writer.flush();
+            } );
+
+         pipeline.run( STDIN_FILENO );
+      }
+
+      writer.flush();
    }
-   else
+   catch( const std::exception & e )
    {
-      throw std::runtime_error( "Error parsing field 2" );
+      statistics.end_phase();
+      statistics.print( std::cerr );
+      std::cerr << argv[0] << ": " << e.what() << '\n';
+      return 1;
    }
 
-   std::cout << '\n';
+   statistics.end_phase();
+   statistics.print( std::cerr );
+
+   return 0;
 }
 
 
-void process_field_2( const std::string & field_2 )
+bool parse_unsigned( const std::string & str, unsigned & value )
 {
-   std::istringstream f2_strm( field_2 );
-   Coalescing_IP_Range_Set set;
-   std::string range_str;
-
-   static constexpr char item_delim = ',';
-
-   while( std::getline( f2_strm, range_str, item_delim ) )
+   if( str.empty() || (str.size() > 9) || (str.find_first_not_of( "0123456789" ) != std::string::npos) )
    {
-      std::istringstream range_strm( range_str );
-      IP_Range range;
-      range_strm >> range;
-      set.insert( range );
+      return false;
    }
 
-   bool needs_preceeding_delimiter = false;
-   for( auto range : set )
-   {
-      if( needs_preceeding_delimiter )
-      {
-         std::cout << item_delim;
-      }
-      std::cout << range;
-      needs_preceeding_delimiter = true;
-   }
+   value = std::stoul( str );
+   return true;
 }
-
@@ -23,23 +23,82 @@
 #include "gtest/gtest.h"
 
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
 
 #include <cfeyer/ip_coalesce/IP_Range.h>
+#include <cfeyer/ip_coalesce/IP6_Range.h>
 #include "Format.h"
 #include "CIDR_Network.h"
 #include "Interval.h"
+#include "Range_Reader.h"
+#include "Range_Writer.h"
+#include "Ordered_Line_Pipeline.h"
+#include "External_Coalescer.h"
+#include "Table_Line_Processor.h"
+#include "Small_Range_Coalescer.h"
+#include "Range_Delta.h"
+#include "Workload_Generator.h"
+#include "Run_Statistics.h"
 #include <cfeyer/ip_coalesce/Coalescing_IP_Range_Set.h>
+#include <cfeyer/ip_coalesce/Flat_IP_Range_Set.h>
+#include <cfeyer/ip_coalesce/DIR_24_8_Table.h>
+#include <cfeyer/ip_coalesce/Range_Set_Algebra.h>
+#include <cfeyer/ip_coalesce/IP_Range_Snapshot.h>
 
 
 using namespace cfeyer::ip_coalesce;
 
 
+// Counts heap allocations so tests can check that hot paths make none.
+// Atomic, as worker threads in other tests allocate too.
+static std::atomic<std::size_t> allocation_count( 0 );
+
+void * operator new( std::size_t size )
+{
+   allocation_count.fetch_add( 1, std::memory_order_relaxed );
+   if( void * p = std::malloc( size ? size : 1 ) ) return p;
+   throw std::bad_alloc();
+}
+
+void operator delete( void * p ) noexcept
+{
+   std::free( p );
+}
+
+void operator delete( void * p, std::size_t ) noexcept
+{
+   std::free( p );
+}
+
+
 TEST(Format, test_to_dotted_octet) {
    EXPECT_EQ( "0.0.0.0", to_dotted_octet(0x00000000) );
    EXPECT_EQ( "255.255.255.255", to_dotted_octet(0xffffffff) );
    EXPECT_EQ( "1.2.3.4", to_dotted_octet(0x01020304) );
 }
 
+TEST(Format, test_format_dotted_octet_for_every_octet_value) {
+   for( uint32_t octet = 0; octet < 256; octet++ )
+   {
+      char buffer[max_dotted_octet_length];
+      std::string expected = std::to_string(octet) + ".0." + std::to_string(octet) + ".255";
+      EXPECT_EQ( expected, std::string( buffer, format_dotted_octet( buffer, from_octets(octet,0,octet,255) ) ) );
+   }
+}
+
+TEST(Format, test_format_decimal) {
+   char buffer[10];
+   EXPECT_EQ( "0", std::string( buffer, format_decimal( buffer, 0 ) ) );
+   EXPECT_EQ( "32", std::string( buffer, format_decimal( buffer, 32 ) ) );
+   EXPECT_EQ( "4294967295", std::string( buffer, format_decimal( buffer, 0xffffffff ) ) );
+}
+
 #define EXPECT_IP_EQ(e,a) \
    { \
       EXPECT_EQ((e),(a)) \
@@ -53,6 +112,45 @@ TEST(Format, test_from_octets) {
    EXPECT_IP_EQ( 0xFF0000FF, from_octets(255,0,0,255) );
 }
 
+// The subnet math is constexpr, so check every prefix length at compile time.
+constexpr uint32_t prefix_length_to_mask( int length )
+{
+   return (length == 0) ? 0 : (0xffffffffu << (32 - length));
+}
+
+constexpr bool prefix_length_math_holds( int length )
+{
+   const uint32_t mask = prefix_length_to_mask( length );
+   const uint64_t address_count = uint64_t( 1 ) << (32 - length);
+
+   return (count_contiguous_network_ones( mask ) == length) &&
+          (netmask_length_to_address_count( length ) == address_count) &&
+          is_power_of_2( address_count ) &&
+          (log_base_2( address_count ) == 32 - length) &&
+          (size_to_subnet_mask( address_count ) == mask) &&
+          (subnet_start_address( 0xffffffff, mask ) == mask) &&
+          (subnet_end_address( 0, mask ) == ~mask) &&
+          is_subnet( mask, address_count ) &&
+          (is_subnet( 0xffffffff, address_count ) == (length == 32)) &&
+          ((length >= 31) || (count_contiguous_network_ones( mask | 1 ) == noncontiguous_subnet_mask));
+}
+
+constexpr bool prefix_length_math_holds_for_all_lengths()
+{
+   for( int length = 0; length <= 32; length++ )
+   {
+      if( !prefix_length_math_holds( length ) ) return false;
+   }
+   return true;
+}
+
+static_assert( prefix_length_math_holds_for_all_lengths(), "subnet math for /0 to /32" );
+static_assert( !is_power_of_2( 0 ) && !is_power_of_2( 3 ) && is_power_of_2( uint64_t( 1 ) << 63 ), "is_power_of_2" );
+static_assert( !is_on_or_adjacent_unchecked( 0, 2, 5 ) && is_on_or_adjacent_unchecked( 1, 2, 5 ) &&
+               is_on_or_adjacent_unchecked( 6, 2, 5 ) && !is_on_or_adjacent_unchecked( 7, 2, 5 ), "adjacency" );
+static_assert( is_on_or_adjacent_unchecked( 0, 0, 0xffffffff ) && is_on_or_adjacent_unchecked( 0xffffffff, 0xffffffff, 0xffffffff ) &&
+               !is_on_or_adjacent_unchecked( 0xffffffff, 0, 0xfffffffd ), "adjacency at the ends of the address space" );
+
 TEST(Subnet, test_count_contiguous_subnet_ones) {
    EXPECT_EQ( 0, count_contiguous_network_ones(0x00000000) );
    EXPECT_EQ( 24, count_contiguous_network_ones(0xffffff00) );
@@ -273,6 +371,12 @@ TEST(IP_Range, test_to_string_with_discontiguous_subnet_mask) {
    EXPECT_EQ( "192.168.1.0/255.128.255.0", IP_Range( from_octets(192,168,1,0), from_octets(255,128,255,0)).to_string() );
 }
 
+TEST(IP_Range, test_from_start_and_end_addresses_rejects_inverted_range) {
+   EXPECT_THROW( IP_Range::from_start_and_end_addresses( 5, 1 ), std::logic_error );
+   EXPECT_THROW( IP_Range::from_start_and_end_addresses( 0xffffffff, 0 ), std::logic_error );
+   EXPECT_EQ( "0.0.0.5", IP_Range::from_start_and_end_addresses( 5, 5 ).to_string() );
+}
+
 TEST(IP_Range, test_is_coalescable_with_same_valued_range) {
    EXPECT_TRUE( IP_Range(0,0).is_coalescable( IP_Range(0,0) ) );
    EXPECT_TRUE( IP_Range(0xffff,0xffffffff).is_coalescable( IP_Range(0xffff,0xffffffff) ) );
@@ -513,6 +617,81 @@ TEST(IP_Range, test_from_string_192_168_0_0_dash_192_168_1_255) {
    EXPECT_TRUE( IP_Range(from_octets(192,168,0,0), from_octets(255,255,254,0)) == range );
 }
 
+TEST(IP_Range, test_from_string_192_168_1_2_slash_24) {
+   IP_Range range;
+   range.from_string( "192.168.1.2/24" );
+   EXPECT_TRUE( IP_Range(from_octets(192,168,1,0), from_octets(255,255,255,0)) == range );
+}
+
+TEST(IP_Range, test_from_string_accepts_leading_zeros) {
+   IP_Range range;
+   range.from_string( "010.000.001.002/024" );
+   EXPECT_TRUE( IP_Range(from_octets(10,0,1,0), from_octets(255,255,255,0)) == range );
+}
+
+TEST(IP_Range, test_from_string_rejects_octets_above_255) {
+   IP_Range range;
+   EXPECT_ANY_THROW( range.from_string( "256.0.0.1" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4/255.255.256.0" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4-1.2.3.1000" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.99999999999999999999" ) );
+}
+
+TEST(IP_Range, test_from_string_rejects_netmask_lengths_above_32) {
+   IP_Range range;
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4/33" ) );
+   EXPECT_NO_THROW( range.from_string( "1.2.3.4/32" ) );
+   EXPECT_NO_THROW( range.from_string( "1.2.3.4/0" ) );
+}
+
+TEST(IP_Range, test_from_string_rejects_dash_range_ending_before_its_start) {
+   IP_Range range;
+   EXPECT_THROW( range.from_string( "10.0.0.5-10.0.0.1" ), std::runtime_error );
+   EXPECT_THROW( range.from_string( "255.255.255.255-0.0.0.0" ), std::runtime_error );
+   EXPECT_FALSE( range.from_four_octet_address_dash_four_octet_address_string( "1.2.3.5-1.2.3.4" ) );
+   EXPECT_NO_THROW( range.from_string( "10.0.0.5-10.0.0.5" ) );
+   EXPECT_EQ( "10.0.0.5", range.to_string() );
+}
+
+TEST(IP_Range, test_from_string_rejects_malformed_strings) {
+   IP_Range range;
+   EXPECT_ANY_THROW( range.from_string( "1.2.3" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3." ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4." ) );
+   EXPECT_ANY_THROW( range.from_string( "1..2.3" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4/" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4-" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4/24x" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4/1.2.3" ) );
+   EXPECT_ANY_THROW( range.from_string( "1.2.3.4 " ) );
+   EXPECT_ANY_THROW( range.from_string( "a.b.c.d" ) );
+}
+
+TEST(IP_Range, test_try_from_string_leaves_range_unchanged_on_failure) {
+   IP_Range range( from_octets(10,0,0,0), from_octets(255,0,0,0) );
+   EXPECT_FALSE( range.try_from_string( "10.0.0.0/99" ) );
+   EXPECT_EQ( IP_Range(from_octets(10,0,0,0), from_octets(255,0,0,0)), range );
+
+   EXPECT_TRUE( range.try_from_string( "10.1.2.3-10.1.2.9" ) );
+   EXPECT_EQ( "10.1.2.3-10.1.2.9", range.to_string() );
+}
+
+TEST(IP_Range, test_from_four_octet_methods_accept_only_their_own_syntax) {
+   IP_Range range;
+
+   EXPECT_TRUE( range.from_four_octet_address_no_netmask_string( "1.2.3.4" ) );
+   EXPECT_FALSE( range.from_four_octet_address_no_netmask_string( "1.2.3.4/24" ) );
+
+   EXPECT_TRUE( range.from_four_octet_address_slash_netmask_length_string( "1.2.3.4/24" ) );
+   EXPECT_FALSE( range.from_four_octet_address_slash_netmask_length_string( "1.2.3.4/255.255.255.0" ) );
+
+   EXPECT_TRUE( range.from_four_octet_address_slash_four_octet_netmask_string( "1.2.3.4/255.255.255.0" ) );
+   EXPECT_FALSE( range.from_four_octet_address_slash_four_octet_netmask_string( "1.2.3.4-1.2.3.5" ) );
+
+   EXPECT_TRUE( range.from_four_octet_address_dash_four_octet_address_string( "1.2.3.4-1.2.3.5" ) );
+   EXPECT_FALSE( range.from_four_octet_address_dash_four_octet_address_string( "1.2.3.4" ) );
+}
+
 TEST(IP_Range, test_stream_input_0_0_0_0_slash_255_255_255_255) {
    std::istringstream strm( "0.0.0.0/255.255.255.255" );
    IP_Range range;
@@ -738,3 +917,1888 @@ TEST(Coalescing_IP_Range_Set, test_add_two_unsorted_uncoalescable_ranges ) {
    iter++;
    EXPECT_TRUE( IP_Range(from_octets(192,168,2,0), from_octets(255,255,255,0)) == *iter );
 }
+
+TEST(Coalescing_IP_Range_Set, test_add_range_that_encloses_existing_ranges_without_touching_their_ends ) {
+   Coalescing_IP_Range_Set set;
+
+   set.insert( IP_Range(from_octets(192,168,1,5), from_octets(255,255,255,255)) );
+   set.insert( IP_Range(from_octets(192,168,1,9), from_octets(255,255,255,255)) );
+   set.insert( IP_Range(from_octets(192,168,1,0), from_octets(255,255,255,0)) );
+
+   EXPECT_EQ( 1, set.size() );
+   EXPECT_EQ( IP_Range(from_octets(192,168,1,0), from_octets(255,255,255,0)), *set.begin() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_ranges_with_discontiguous_subnet_masks_are_never_coalesced ) {
+   Coalescing_IP_Range_Set set;
+
+   set.insert( IP_Range(from_octets(192,168,0,0), from_octets(255,255,0,0)) );
+   set.insert( IP_Range(from_octets(192,168,1,0), from_octets(255,255,0,255)) );
+   set.insert( IP_Range(from_octets(192,169,0,0), from_octets(255,255,0,0)) );
+
+   EXPECT_EQ( 2, set.size() );
+
+   auto iter = set.begin();
+   EXPECT_EQ( "192.168.0.0/15", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "192.168.1.0/255.255.0.255", iter->to_string() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_add_many_adjacent_ranges_in_reverse_order ) {
+   Coalescing_IP_Range_Set set;
+
+   for( int i = 255; i >= 0; i-- )
+   {
+      set.insert( IP_Range(from_octets(10,0,i,0), from_octets(255,255,255,0)) );
+   }
+
+   EXPECT_EQ( 1, set.size() );
+   EXPECT_EQ( "10.0.0.0/16", set.begin()->to_string() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_add_alternating_ranges_then_fill_gaps ) {
+   Coalescing_IP_Range_Set set;
+
+   for( int i = 0; i < 256; i += 2 )
+   {
+      set.insert( IP_Range(from_octets(10,0,i,0), from_octets(255,255,255,0)) );
+   }
+
+   EXPECT_EQ( 128, set.size() );
+
+   for( int i = 1; i < 256; i += 2 )
+   {
+      set.insert( IP_Range(from_octets(10,0,i,0), from_octets(255,255,255,0)) );
+   }
+
+   EXPECT_EQ( 1, set.size() );
+   EXPECT_EQ( "10.0.0.0/16", set.begin()->to_string() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_build_from_unsorted_overlapping_and_adjacent_ranges ) {
+   std::vector<IP_Range> ranges = {
+      IP_Range(from_octets(192,168,2,0), from_octets(255,255,255,0)),
+      IP_Range(from_octets(10,0,0,7), from_octets(255,255,255,255)),
+      IP_Range(from_octets(192,168,0,0), from_octets(255,255,255,0)),
+      IP_Range(from_octets(192,168,1,0), from_octets(255,255,255,0)),
+      IP_Range(from_octets(192,168,1,128), from_octets(255,255,255,128)),
+      IP_Range(from_octets(192,168,4,0), from_octets(255,255,255,0))
+   };
+
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   EXPECT_EQ( 3, set.size() );
+
+   auto iter = set.begin();
+   EXPECT_EQ( "10.0.0.7", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "192.168.0.0-192.168.2.255", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "192.168.4.0/24", iter->to_string() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_build_keeps_ranges_with_discontiguous_subnet_masks_in_order ) {
+   std::vector<IP_Range> ranges = {
+      IP_Range(from_octets(192,169,0,0), from_octets(255,255,0,0)),
+      IP_Range(from_octets(192,168,1,0), from_octets(255,255,0,255)),
+      IP_Range(from_octets(192,168,0,0), from_octets(255,255,0,0)),
+      IP_Range(from_octets(192,168,1,0), from_octets(255,255,0,255))
+   };
+
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   EXPECT_EQ( 2, set.size() );
+
+   auto iter = set.begin();
+   EXPECT_EQ( "192.168.0.0/15", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "192.168.1.0/255.255.0.255", iter->to_string() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_insert_batch_matches_one_at_a_time_insert ) {
+   std::vector<IP_Range> ranges;
+   for( int i = 0; i < 256; i += 3 )
+   {
+      ranges.push_back( IP_Range(from_octets(10,0,i,0), from_octets(255,255,254,0)) );
+   }
+
+   Coalescing_IP_Range_Set one_at_a_time;
+   for( const IP_Range & range : ranges )
+   {
+      one_at_a_time.insert( range );
+   }
+
+   Coalescing_IP_Range_Set batch;
+   batch.insert( IP_Range(from_octets(10,0,255,0), from_octets(255,255,255,0)) );
+   batch.insert( ranges.begin(), ranges.end() );
+
+   one_at_a_time.insert( IP_Range(from_octets(10,0,255,0), from_octets(255,255,255,0)) );
+
+   ASSERT_EQ( one_at_a_time.size(), batch.size() );
+   EXPECT_TRUE( std::equal( one_at_a_time.begin(), one_at_a_time.end(), batch.begin() ) );
+}
+
+TEST(Coalescing_IP_Range_Set, test_sort_and_coalesce_empty_vector ) {
+   std::vector<IP_Range> ranges;
+   sort_and_coalesce( ranges );
+   EXPECT_TRUE( ranges.empty() );
+}
+
+TEST(Flat_IP_Range_Set, test_add_two_presorted_coalescable_ranges ) {
+   Flat_IP_Range_Set set;
+   EXPECT_EQ( 0, set.size() );
+   EXPECT_TRUE( set.begin() == set.end() );
+
+   set.insert( IP_Range(from_octets(192,168,0,0), from_octets(255,255,255,0)) );
+   set.insert( IP_Range(from_octets(192,168,1,0), from_octets(255,255,255,0)) );
+
+   EXPECT_EQ( 1, set.size() );
+   EXPECT_EQ( IP_Range(from_octets(192,168,0,0), from_octets(255,255,254,0)), *set.begin() );
+}
+
+TEST(Flat_IP_Range_Set, test_add_range_that_spans_over_most ) {
+   Flat_IP_Range_Set set;
+
+   set.insert( IP_Range(from_octets(192,168,0,0), from_octets(255,255,255,0)) );
+   set.insert( IP_Range(from_octets(192,168,2,0), from_octets(255,255,255,0)) );
+   set.insert( IP_Range(from_octets(192,168,4,0), from_octets(255,255,255,0)) );
+   set.insert( IP_Range(from_octets(255,255,255,0), from_octets(255,255,255,0)) );
+
+   EXPECT_EQ( 4, set.size() );
+
+   set.insert( IP_Range(from_octets(192,168,1,7), from_octets(255,255,0,0)) );
+
+   EXPECT_EQ( 2, set.size() );
+
+   auto iter = set.begin();
+   EXPECT_EQ( "192.168.0.0/16", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "255.255.255.0/24", iter->to_string() );
+   iter++;
+   EXPECT_TRUE( iter == set.end() );
+}
+
+TEST(Flat_IP_Range_Set, test_add_ranges_at_ends_of_address_space ) {
+   Flat_IP_Range_Set set;
+
+   set.insert( IP_Range(from_octets(255,255,255,255), from_octets(255,255,255,255)) );
+   set.insert( IP_Range(from_octets(0,0,0,0), from_octets(255,255,255,255)) );
+   set.insert( IP_Range(from_octets(0,0,0,1), from_octets(255,255,255,255)) );
+   set.insert( IP_Range(from_octets(255,255,255,254), from_octets(255,255,255,255)) );
+
+   EXPECT_EQ( 2, set.size() );
+
+   auto iter = set.begin();
+   EXPECT_EQ( "0.0.0.0/31", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "255.255.255.254/31", iter->to_string() );
+}
+
+TEST(Flat_IP_Range_Set, test_iteration_interleaves_ranges_with_discontiguous_subnet_masks ) {
+   Flat_IP_Range_Set set;
+
+   set.insert( IP_Range(from_octets(192,169,0,0), from_octets(255,255,0,0)) );
+   set.insert( IP_Range(from_octets(192,168,1,0), from_octets(255,255,0,255)) );
+   set.insert( IP_Range(from_octets(10,0,0,0), from_octets(255,0,0,0)) );
+   set.insert( IP_Range(from_octets(192,168,1,0), from_octets(255,255,0,255)) );
+
+   EXPECT_EQ( 3, set.size() );
+
+   auto iter = set.begin();
+   EXPECT_EQ( "10.0.0.0/8", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "192.168.1.0/255.255.0.255", iter->to_string() );
+   iter++;
+   EXPECT_EQ( "192.169.0.0/16", iter->to_string() );
+}
+
+TEST(Flat_IP_Range_Set, test_matches_coalescing_ip_range_set ) {
+   std::vector<IP_Range> ranges;
+   uint32_t seed = 12345;
+
+   for( int i = 0; i < 2000; i++ )
+   {
+      seed = seed * 1103515245 + 12345;
+      uint32_t address = from_octets( 10, 0, (seed >> 16) & 0xff, (seed >> 8) & 0xff );
+      uint32_t mask = 0xffffffff << ((seed >> 4) & 0x7);
+      ranges.push_back( IP_Range(address, mask) );
+   }
+
+   Coalescing_IP_Range_Set expected;
+   Flat_IP_Range_Set one_at_a_time;
+   for( const IP_Range & range : ranges )
+   {
+      expected.insert( range );
+      one_at_a_time.insert( range );
+   }
+
+   Flat_IP_Range_Set built = Flat_IP_Range_Set::build( std::vector<IP_Range>(ranges) );
+
+   ASSERT_LT( 100, expected.size() );
+   ASSERT_EQ( expected.size(), one_at_a_time.size() );
+   EXPECT_TRUE( std::equal( expected.begin(), expected.end(), one_at_a_time.begin() ) );
+
+   ASSERT_EQ( expected.size(), built.size() );
+   EXPECT_TRUE( std::equal( expected.begin(), expected.end(), built.begin() ) );
+}
+
+TEST(Coalescing_IP_Range_Set, test_parallel_sort_and_coalesce_matches_serial ) {
+   std::vector<IP_Range> ranges;
+   uint32_t seed = 54321;
+
+   for( int i = 0; i < 50000; i++ )
+   {
+      seed = seed * 1103515245 + 12345;
+      uint32_t address = from_octets( 10, (seed >> 24) & 0x03, (seed >> 16) & 0xff, (seed >> 8) & 0xff );
+      uint32_t mask = ((seed & 0x3f) == 0) ? 0xffff00ff : (0xffffffff << ((seed >> 4) & 0x7));
+      ranges.push_back( IP_Range(address, mask) );
+   }
+
+   std::vector<IP_Range> serial( ranges );
+   sort_and_coalesce( serial );
+
+   for( unsigned thread_count : { 2u, 3u, 5u, 8u } )
+   {
+      std::vector<IP_Range> parallel( ranges );
+      sort_and_coalesce( parallel, thread_count );
+
+      ASSERT_EQ( serial.size(), parallel.size() ) << "thread_count=" << thread_count;
+      EXPECT_TRUE( std::equal( serial.begin(), serial.end(), parallel.begin() ) ) << "thread_count=" << thread_count;
+   }
+}
+
+TEST(IP_Range, test_parse_ranges_from_empty_and_blank_text) {
+   std::vector<IP_Range> ranges;
+
+   parse_ranges( "", ranges );
+   EXPECT_TRUE( ranges.empty() );
+
+   parse_ranges( " \n\t\r\v\f ", ranges );
+   EXPECT_TRUE( ranges.empty() );
+}
+
+TEST(IP_Range, test_parse_ranges_matches_stream_input) {
+   std::string text;
+   for( int i = 0; i < 300; i++ )
+   {
+      text += std::to_string(i % 256) + ".0." + std::to_string(i / 7) + ".1";
+      text += (i % 3 == 0) ? "/24" : (i % 3 == 1) ? "-255.255.255.255" : "";
+      text += (i % 5 == 0) ? "\n" : (i % 5 == 1) ? "  \t" : " ";
+   }
+
+   text += "1.2.3.4";
+
+   for( std::size_t length : { text.size(), text.size() - 8, std::size_t(64), std::size_t(128), std::size_t(129) } )
+   {
+      std::string prefix = (length == text.size()) ?
+         text : text.substr( 0, text.find_last_of( " \t\n", length - 1 ) + 1 );
+
+      std::vector<IP_Range> expected;
+      std::istringstream strm( prefix );
+      IP_Range range;
+      while( strm >> range )
+      {
+         expected.push_back( range );
+      }
+
+      std::vector<IP_Range> actual;
+      parse_ranges( prefix, actual );
+
+      ASSERT_EQ( expected.size(), actual.size() ) << "length=" << length;
+      EXPECT_TRUE( std::equal( expected.begin(), expected.end(), actual.begin() ) ) << "length=" << length;
+   }
+}
+
+TEST(IP_Range, test_parse_ranges_agrees_with_from_string_on_each_token) {
+   const char * tokens[] = {
+      "0.0.0.0", "255.255.255.255", "1.22.133.4", "100.20.3.255/0", "10.0.0.0/8",
+      "10.0.0.7/32", "1.2.3.4-1.2.3.5", "200.100.10.1-1.2.3.4", "001.002.003.004",
+      "0001.2.3.4", "1.2.3.0004", "1.2.3.4/032", "1.2.3.4/255.255.0.0",
+      "1.2.3.4/255.0.255.0", "::ffff:1.2.3.4", "2001:db8::/32",
+      "256.0.0.1", "1.2.3.256", "1.2.3.4/33", "1.2.3.4/", "1.2.3.4-", "1.2.3",
+      "1.2.3.4.5", "1..2.3", ".1.2.3", "1.2.3.4/3a", "1.2.3.4-5.6.7.8/9",
+      "1.2.3.4x", "999.1.1.1", "1.2.3.4-1.2.3", "1.2.3.5-1.2.3.4", "1.2.3.4-1.2.3.4"
+   };
+
+   // Padding keeps each token clear of the end of the text, where parsing
+   // may take a different path.
+   for( const char * token : tokens )
+   {
+      std::string text = std::string( token ) + "                ";
+
+      IP_Range expected;
+      bool is_expected_valid = expected.try_from_string( token );
+
+      std::vector<IP_Range> ranges;
+      std::vector<IP6_Range> ip6_ranges;
+
+      if( is_expected_valid )
+      {
+         parse_ranges( text, ranges, ip6_ranges );
+         ASSERT_EQ( 1u, ranges.size() ) << token;
+         EXPECT_EQ( expected, ranges[0] ) << token;
+         EXPECT_EQ( expected.to_string(), ranges[0].to_string() ) << token;
+      }
+      else
+      {
+         EXPECT_ANY_THROW( parse_ranges( text, ranges ) ) << token;
+      }
+   }
+}
+
+TEST(IP_Range, test_parse_ranges_throws_on_malformed_token) {
+   std::vector<IP_Range> ranges;
+   EXPECT_ANY_THROW( parse_ranges( "1.2.3.4 1.2.3.4/33 5.6.7.8", ranges ) );
+}
+
+TEST(IP_Range, test_format_range_matches_to_string) {
+   const IP_Range ranges[] = {
+      IP_Range(from_octets(0,0,0,0), from_octets(0,0,0,0)),
+      IP_Range(from_octets(192,168,1,2), from_octets(255,255,255,255)),
+      IP_Range(from_octets(192,168,1,0), from_octets(255,255,255,0)),
+      IP_Range(from_octets(255,255,255,255), from_octets(255,255,0,255)),
+      IP_Range::from_start_and_end_addresses( from_octets(255,255,255,254), from_octets(255,255,255,255) ) + IP_Range(0xfffffffd, 0xffffffff),
+      IP_Range::from_start_and_end_addresses( from_octets(10,0,0,3), from_octets(10,0,0,200) )
+   };
+
+   for( const IP_Range & range : ranges )
+   {
+      char buffer[IP_Range::max_string_length];
+      char * end = format_range( buffer, range );
+
+      ASSERT_LE( end - buffer, static_cast<std::ptrdiff_t>(IP_Range::max_string_length) );
+      EXPECT_EQ( range.to_string(), std::string( buffer, end ) );
+   }
+
+   EXPECT_EQ( "255.255.255.253-255.255.255.255", ranges[4].to_string() );
+   EXPECT_EQ( "255.255.255.255/255.255.0.255", ranges[3].to_string() );
+   EXPECT_EQ( "0.0.0.0/0", ranges[0].to_string() );
+}
+
+static const char * const range_reader_text =
+   "10.0.0.1 10.0.0.2/31\n192.168.0.0-192.168.0.255\t\t1.2.3.4/255.255.0.255\n\n  8.8.8.8";
+
+static std::vector<IP_Range> expected_range_reader_ranges()
+{
+   std::vector<IP_Range> ranges;
+   std::istringstream strm( range_reader_text );
+   IP_Range range;
+   while( strm >> range )
+   {
+      ranges.push_back( range );
+   }
+   return ranges;
+}
+
+TEST(Range_Reader, test_read_memory_mapped_file_in_small_chunks) {
+   char path[] = "/tmp/ip_coalesce_range_reader_XXXXXX";
+   int fd = mkstemp( path );
+   ASSERT_LE( 0, fd );
+   ASSERT_EQ( static_cast<ssize_t>(strlen(range_reader_text)), write( fd, range_reader_text, strlen(range_reader_text) ) );
+   close( fd );
+
+   for( std::size_t chunk_size : { 1, 7, 64, 4096 } )
+   {
+      Range_Reader reader( path, chunk_size );
+      EXPECT_TRUE( reader.is_memory_mapped() );
+
+      std::vector<IP_Range> ranges;
+      reader.read_all( ranges );
+
+      std::vector<IP_Range> expected = expected_range_reader_ranges();
+      ASSERT_EQ( expected.size(), ranges.size() ) << "chunk_size=" << chunk_size;
+      EXPECT_TRUE( std::equal( expected.begin(), expected.end(), ranges.begin() ) ) << "chunk_size=" << chunk_size;
+   }
+
+   unlink( path );
+}
+
+TEST(Range_Reader, test_read_pipe_in_small_chunks) {
+   for( std::size_t chunk_size : { 1, 7, 64, 4096 } )
+   {
+      int fds[2];
+      ASSERT_EQ( 0, pipe( fds ) );
+      ASSERT_EQ( static_cast<ssize_t>(strlen(range_reader_text)), write( fds[1], range_reader_text, strlen(range_reader_text) ) );
+      close( fds[1] );
+
+      std::vector<IP_Range> ranges;
+      {
+         Range_Reader reader( fds[0], chunk_size );
+         EXPECT_FALSE( reader.is_memory_mapped() );
+         reader.read_all( ranges );
+      }
+      close( fds[0] );
+
+      std::vector<IP_Range> expected = expected_range_reader_ranges();
+      ASSERT_EQ( expected.size(), ranges.size() ) << "chunk_size=" << chunk_size;
+      EXPECT_TRUE( std::equal( expected.begin(), expected.end(), ranges.begin() ) ) << "chunk_size=" << chunk_size;
+   }
+}
+
+TEST(Range_Reader, test_open_missing_file_throws_exception) {
+   EXPECT_ANY_THROW( Range_Reader( "/nonexistent/ip_coalesce_input" ) );
+}
+
+static std::vector<IP_Range> external_coalescer_test_ranges( int count )
+{
+   std::vector<IP_Range> ranges;
+   uint32_t state = 12345;
+   for( int i = 0; i < count; i++ )
+   {
+      state = state * 1103515245u + 12345u;
+      uint32_t start = (state >> 8) % 200000;
+      state = state * 1103515245u + 12345u;
+      uint32_t length = (state >> 8) % 64;
+
+      if( i % 50 == 0 )
+      {
+         // Same bounds as a single-address range, but never coalesced.
+         IP_Range noncontiguous;
+         noncontiguous.from_four_octet_address_slash_four_octet_netmask_string( to_dotted_octet( start ) + "/255.255.0.255" );
+         ranges.push_back( noncontiguous );
+         ranges.push_back( IP_Range::from_start_and_end_addresses( start, start ) );
+      }
+      else
+      {
+         ranges.push_back( IP_Range::from_start_and_end_addresses( start, start + length ) );
+      }
+   }
+   return ranges;
+}
+
+static std::vector<IP_Range> coalesce_externally( const std::vector<IP_Range> & ranges, std::size_t max_memory_bytes, int & run_count )
+{
+   External_Coalescer coalescer( max_memory_bytes );
+   coalescer.insert( ranges.begin(), ranges.end() );
+   run_count = coalescer.run_count();
+
+   std::vector<IP_Range> result;
+   coalescer.finish( [&]( const IP_Range & range ) { result.push_back( range ); } );
+   return result;
+}
+
+TEST(External_Coalescer, test_matches_in_memory_coalescing) {
+   std::vector<IP_Range> ranges = external_coalescer_test_ranges( 20000 );
+
+   Coalescing_IP_Range_Set expected_set = Coalescing_IP_Range_Set::build( std::vector<IP_Range>( ranges ) );
+   std::vector<std::string> expected;
+   for( const IP_Range & range : expected_set ) expected.push_back( range.to_string() );
+
+   // From everything in memory, through a handful of runs, to so many runs
+   // that merging takes more than one pass.
+   for( std::size_t max_memory_bytes : { 16u << 20, 1u << 20, 64u << 10 } )
+   {
+      int run_count = 0;
+      std::vector<IP_Range> result = coalesce_externally( ranges, max_memory_bytes, run_count );
+
+      std::vector<std::string> actual;
+      for( const IP_Range & range : result ) actual.push_back( range.to_string() );
+
+      EXPECT_EQ( expected, actual ) << "max_memory_bytes=" << max_memory_bytes << " run_count=" << run_count;
+      if( max_memory_bytes == (64u << 10) )
+      {
+         EXPECT_GT( run_count, 2 );
+      }
+   }
+}
+
+TEST(External_Coalescer, test_runs_are_merged_as_they_spill) {
+   // A 64K budget merges two runs at a time, so about a hundred spilled
+   // chunks leave one run per level, the set bits of the chunk count.
+   std::vector<IP_Range> ranges = external_coalescer_test_ranges( 200000 );
+
+   Coalescing_IP_Range_Set expected_set = Coalescing_IP_Range_Set::build( std::vector<IP_Range>( ranges ) );
+   std::vector<std::string> expected;
+   for( const IP_Range & range : expected_set ) expected.push_back( range.to_string() );
+
+   int run_count = 0;
+   std::vector<IP_Range> result = coalesce_externally( ranges, 64u << 10, run_count );
+
+   std::vector<std::string> actual;
+   for( const IP_Range & range : result ) actual.push_back( range.to_string() );
+
+   EXPECT_EQ( expected, actual );
+   EXPECT_GE( run_count, 1 );
+   EXPECT_LE( run_count, 8 );
+}
+
+TEST(External_Coalescer, test_patterns_under_a_wide_range_are_spilled) {
+   // Every pattern starts inside 0.0.0.0/1, which stays open until the end,
+   // so they are held far beyond the 16K budget and must be spilled; one
+   // sorts before the wide range, sharing its start.
+   std::vector<IP_Range> ranges;
+   ranges.push_back( IP_Range( 0, 0x80000000 ) );
+   ranges.push_back( IP_Range( 0, 0x00ff00ff ) );
+
+   std::srand( 9 );
+   for( int i = 0; i < 20000; i++ )
+   {
+      ranges.push_back( IP_Range( static_cast<uint32_t>(std::rand()) & 0x7fffff00, 0xff00ffff ) );
+   }
+
+   Coalescing_IP_Range_Set expected_set = Coalescing_IP_Range_Set::build( std::vector<IP_Range>( ranges ) );
+   std::vector<std::string> expected;
+   for( const IP_Range & range : expected_set ) expected.push_back( range.to_string() );
+
+   for( std::size_t budget : { std::size_t(16u << 10), std::size_t(1u << 20) } )
+   {
+      int run_count = 0;
+      std::vector<IP_Range> result = coalesce_externally( ranges, budget, run_count );
+
+      std::vector<std::string> actual;
+      for( const IP_Range & range : result ) actual.push_back( range.to_string() );
+
+      EXPECT_EQ( expected, actual ) << "budget=" << budget;
+   }
+}
+
+TEST(External_Coalescer, test_finish_with_no_ranges) {
+   int run_count = 0;
+   EXPECT_TRUE( coalesce_externally( {}, 1u << 20, run_count ).empty() );
+   EXPECT_EQ( 0, run_count );
+}
+
+static std::string read_all_from_fd( int fd )
+{
+   std::string text;
+   char buffer[4096];
+   ssize_t count;
+   while( (count = read( fd, buffer, sizeof(buffer) )) > 0 )
+   {
+      text.append( buffer, count );
+   }
+   return text;
+}
+
+TEST(Range_Writer, test_writes_ranges_and_text_in_order) {
+   std::vector<IP_Range> ranges = expected_range_reader_ranges();
+
+   std::string expected;
+   for( const IP_Range & range : ranges )
+   {
+      expected += range.to_string() + ",";
+   }
+   expected += std::string( 100, 'x' ) + "\n";
+
+   // Buffers smaller than a range or than the text still write everything.
+   for( std::size_t buffer_size : { 1, 40, 4096 } )
+   {
+      FILE * file = tmpfile();
+      ASSERT_NE( nullptr, file );
+      {
+         Range_Writer writer( fileno( file ), false, buffer_size );
+         for( const IP_Range & range : ranges )
+         {
+            writer.write( range );
+            writer.write( ',' );
+         }
+         writer.write( std::string( 100, 'x' ) );
+         writer.end_line();
+      }
+      rewind( file );
+      EXPECT_EQ( expected, read_all_from_fd( fileno( file ) ) ) << "buffer_size=" << buffer_size;
+      fclose( file );
+   }
+}
+
+TEST(Range_Writer, test_line_buffered_flushes_each_line) {
+   int fds[2];
+   ASSERT_EQ( 0, pipe( fds ) );
+
+   Range_Writer writer( fds[1], true );
+   writer.write( IP_Range::from_start_and_end_addresses( 0x0a000000, 0x0a0000ff ) );
+   writer.end_line();
+
+   char buffer[64] = {};
+   ASSERT_EQ( 12, read( fds[0], buffer, sizeof(buffer) ) );
+   EXPECT_STREQ( "10.0.0.0/24\n", buffer );
+
+   close( fds[0] );
+   close( fds[1] );
+}
+
+static std::string run_ordered_line_pipeline( const std::string & input, unsigned thread_count, std::size_t batch_size )
+{
+   FILE * file = tmpfile();
+   fwrite( input.data(), 1, input.size(), file );
+   fflush( file );
+   rewind( file );
+
+   // Tags every line with its length, so lost, repeated or reordered lines
+   // all show up in the output.
+   auto process_lines = []( std::string_view lines, std::string & output )
+   {
+      while( !lines.empty() )
+      {
+         std::size_t line_end = lines.find( '\n' );
+         std::string_view line = lines.substr( 0, line_end );
+         lines.remove_prefix( (line_end == std::string_view::npos) ? lines.size() : line_end + 1 );
+
+         if( line == "bad" ) throw std::runtime_error( "bad line" );
+
+         output += std::to_string( line.size() ) + ":" + std::string( line ) + "\n";
+      }
+   };
+
+   std::string output;
+   Ordered_Line_Pipeline pipeline( thread_count, process_lines,
+                                   [&]( std::string_view text ) { output += text; },
+                                   batch_size );
+   try
+   {
+      pipeline.run( fileno( file ) );
+   }
+   catch( ... )
+   {
+      fclose( file );
+      throw;
+   }
+
+   fclose( file );
+   return output;
+}
+
+TEST(Ordered_Line_Pipeline, test_output_is_in_input_order) {
+   std::string input;
+   std::string expected;
+   for( int i = 0; i < 5000; i++ )
+   {
+      std::string line = "line" + std::to_string( i * 7919 % 10007 );
+      input += line + "\n";
+      expected += std::to_string( line.size() ) + ":" + line + "\n";
+   }
+
+   for( unsigned thread_count : { 1, 2, 5 } )
+   {
+      for( std::size_t batch_size : { 1, 10, 4096, 1 << 20 } )
+      {
+         EXPECT_EQ( expected, run_ordered_line_pipeline( input, thread_count, batch_size ) )
+            << "thread_count=" << thread_count << " batch_size=" << batch_size;
+      }
+   }
+}
+
+TEST(Ordered_Line_Pipeline, test_last_line_without_newline) {
+   EXPECT_EQ( "1:a\n0:\n3:bcd\n", run_ordered_line_pipeline( "a\n\nbcd", 2, 2 ) );
+   EXPECT_EQ( "", run_ordered_line_pipeline( "", 2, 2 ) );
+}
+
+TEST(Ordered_Line_Pipeline, test_exception_is_rethrown) {
+   std::string input;
+   for( int i = 0; i < 1000; i++ )
+   {
+      input += (i == 600) ? "bad\n" : "good\n";
+   }
+
+   EXPECT_THROW( run_ordered_line_pipeline( input, 3, 64 ), std::runtime_error );
+}
+
+static std::string process_table_line( const std::string & line )
+{
+   Table_Line_Processor processor;
+   std::string output;
+   processor.process_line( line, output );
+   return output;
+}
+
+TEST(Table_Line_Processor, test_process_line) {
+   EXPECT_EQ( "a:1.2.3.0/31,5.6.7.8", process_table_line( "a:5.6.7.8,1.2.3.1,1.2.3.0" ) );
+   EXPECT_EQ( "b:1.2.3.4", process_table_line( "b:1.2.3.4," ) );
+   EXPECT_EQ( "c:0.0.0.0,1.2.3.4", process_table_line( "c:1.2.3.4,," ) );
+   EXPECT_EQ( ":1.0.0.0/8", process_table_line( ":1.0.0.0/8" ) );
+   EXPECT_EQ( "d:1.2.3.4/31", process_table_line( "d: \t1.2.3.4,1.2.3.5 ignored" ) );
+   EXPECT_EQ( "e:1.0.3.0,1.2.3.4/255.0.255.0",
+              process_table_line( "e:1.2.3.4/255.0.255.0,1.0.3.0,1.0.3.0/255.0.255.0" ) );
+}
+
+TEST(Table_Line_Processor, test_missing_field_throws_exception) {
+   EXPECT_THROW( process_table_line( "" ), std::runtime_error );
+   EXPECT_THROW( process_table_line( "no_delimiter" ), std::runtime_error );
+   EXPECT_THROW( process_table_line( "f:" ), std::runtime_error );
+   EXPECT_THROW( process_table_line( "g:   " ), std::runtime_error );
+   EXPECT_ANY_THROW( process_table_line( "h:1.2.3.256" ) );
+}
+
+TEST(Table_Line_Processor, test_process_lines) {
+   Table_Line_Processor processor;
+   std::string output;
+   processor.process_lines( "a:1.2.3.4,1.2.3.5\nb:10.0.0.0/8\nc:1.1.1.1", output );
+   EXPECT_EQ( "a:1.2.3.4/31\nb:10.0.0.0/8\nc:1.1.1.1\n", output );
+}
+
+TEST(Table_Line_Processor, test_steady_state_does_not_allocate) {
+   const std::string lines[] = {
+      "customer_1:10.0.0.0/24,10.0.1.0-10.0.1.255,192.168.1.1,10.0.2.0/23",
+      "customer_2:172.16.0.0/12,1.2.3.4",
+      "customer_3:8.8.8.8,8.8.4.4,8.8.8.9,8.8.8.10-8.8.8.20",
+   };
+
+   Table_Line_Processor processor;
+   std::string output;
+   output.reserve( 1024 );
+
+   for( const std::string & line : lines )
+   {
+      processor.process_line( line, output );
+      output.clear();
+   }
+
+   std::size_t allocations_before = allocation_count;
+   for( int i = 0; i < 1000; i++ )
+   {
+      processor.process_line( lines[i % 3], output );
+      output.clear();
+   }
+   EXPECT_EQ( allocations_before, allocation_count );
+}
+
+TEST(Small_Range_Coalescer, test_matches_coalescing_set) {
+   uint32_t state = 99;
+   auto next = [&]( uint32_t bound ) { state = state * 1103515245u + 12345u; return (state >> 8) % bound; };
+
+   for( int trial = 0; trial < 2000; trial++ )
+   {
+      std::size_t count = 1 + next( Small_Range_Coalescer::capacity );
+      std::vector<IP_Range> ranges;
+      Small_Range_Coalescer coalescer;
+
+      for( std::size_t i = 0; i < count; i++ )
+      {
+         uint32_t start = next( 64 );
+         IP_Range range = IP_Range::from_start_and_end_addresses( start, start + next( 8 ) );
+         if( next( 6 ) == 0 )
+         {
+            range.from_four_octet_address_slash_four_octet_netmask_string( to_dotted_octet( start ) + "/255.255.0.255" );
+         }
+
+         ranges.push_back( range );
+         ASSERT_TRUE( coalescer.push_back( range ) );
+      }
+
+      coalescer.coalesce();
+
+      std::vector<std::string> expected;
+      for( const IP_Range & range : Coalescing_IP_Range_Set::build( std::move(ranges) ) )
+      {
+         expected.push_back( range.to_string() );
+      }
+
+      std::vector<std::string> actual;
+      for( const IP_Range & range : coalescer )
+      {
+         actual.push_back( range.to_string() );
+      }
+
+      ASSERT_EQ( expected, actual ) << "trial=" << trial;
+   }
+}
+
+TEST(Small_Range_Coalescer, test_push_back_when_full) {
+   Small_Range_Coalescer coalescer;
+   for( std::size_t i = 0; i < Small_Range_Coalescer::capacity; i++ )
+   {
+      EXPECT_TRUE( coalescer.push_back( IP_Range::from_start_and_end_addresses( 2 * i, 2 * i ) ) );
+   }
+   EXPECT_FALSE( coalescer.push_back( IP_Range::from_start_and_end_addresses( 100, 100 ) ) );
+   EXPECT_EQ( Small_Range_Coalescer::capacity, coalescer.size() );
+
+   coalescer.clear();
+   EXPECT_EQ( 0u, coalescer.size() );
+   EXPECT_TRUE( coalescer.push_back( IP_Range::from_start_and_end_addresses( 100, 100 ) ) );
+}
+
+TEST(Table_Line_Processor, test_line_with_more_ranges_than_small_capacity) {
+   std::string line = "big:";
+   for( int i = 0; i < 40; i++ )
+   {
+      line += (i ? "," : "") + to_dotted_octet( 0x0a000000 + 2 * i ) + "-" + to_dotted_octet( 0x0a000000 + 2 * i + 1 );
+   }
+   EXPECT_EQ( "big:10.0.0.0-10.0.0.79", process_table_line( line ) );
+}
+
+static std::vector<std::string> cidr_block_strings( uint32_t start, uint32_t end )
+{
+   std::vector<IP_Range> blocks;
+   append_cidr_blocks( IP_Range::from_start_and_end_addresses( start, end ), blocks );
+
+   std::vector<std::string> strings;
+   for( const IP_Range & block : blocks ) strings.push_back( block.to_string() );
+   return strings;
+}
+
+TEST(CIDR_Blocks, test_append_cidr_blocks) {
+   EXPECT_EQ( std::vector<std::string>{ "0.0.0.0/0" }, cidr_block_strings( 0, 0xffffffff ) );
+   EXPECT_EQ( std::vector<std::string>{ "1.2.3.4" }, cidr_block_strings( 0x01020304, 0x01020304 ) );
+   EXPECT_EQ( std::vector<std::string>{ "10.0.0.0/24" }, cidr_block_strings( 0x0a000000, 0x0a0000ff ) );
+   EXPECT_EQ( (std::vector<std::string>{ "10.0.0.1", "10.0.0.2/31", "10.0.0.4/31", "10.0.0.6" }),
+              cidr_block_strings( 0x0a000001, 0x0a000006 ) );
+   EXPECT_EQ( std::vector<std::string>{ "255.255.255.254/31" }, cidr_block_strings( 0xfffffffe, 0xffffffff ) );
+   EXPECT_EQ( 62u, cidr_block_strings( 1, 0xfffffffe ).size() );
+}
+
+TEST(CIDR_Blocks, test_blocks_are_aligned_minimal_and_cover_range) {
+   uint32_t state = 7;
+   auto next = [&]() { state = state * 1103515245u + 12345u; return state; };
+
+   for( int trial = 0; trial < 10000; trial++ )
+   {
+      uint32_t a = next() ^ (next() << 16);
+      uint32_t b = (trial % 2) ? (a + (next() % 5000)) : (next() ^ (next() << 16));
+      if( b < a ) std::swap( a, b );
+
+      std::vector<IP_Range> blocks;
+      append_cidr_blocks( IP_Range::from_start_and_end_addresses( a, b ), blocks );
+
+      uint64_t expected_start = a;
+      for( std::size_t i = 0; i < blocks.size(); i++ )
+      {
+         const IP_Range & block = blocks[i];
+         ASSERT_EQ( expected_start, block.get_start_address() );
+         ASSERT_TRUE( block.is_subnet() );
+
+         // Two neighbors of equal size that align as one bigger block
+         // should have been that block.
+         if( i > 0 )
+         {
+            const IP_Range & previous = blocks[i-1];
+            ASSERT_FALSE( (previous.size() == block.size()) &&
+                          ((previous.get_start_address() & (2 * block.size() - 1)) == 0) )
+               << previous << " " << block;
+         }
+
+         expected_start = static_cast<uint64_t>(block.get_end_address()) + 1;
+      }
+      ASSERT_EQ( static_cast<uint64_t>(b) + 1, expected_start );
+   }
+}
+
+TEST(CIDR_Blocks, test_noncontiguous_range_is_rejected) {
+   IP_Range range;
+   range.from_string( "1.2.3.4/255.0.255.0" );
+
+   std::vector<IP_Range> blocks;
+   EXPECT_THROW( append_cidr_blocks( range, blocks ), std::invalid_argument );
+   EXPECT_TRUE( blocks.empty() );
+}
+
+TEST(CIDR_Blocks, test_inverted_range_is_rejected) {
+   // An inverted IP_Range cannot be built, see
+   // test_from_start_and_end_addresses_rejects_inverted_range.
+   std::vector<IP6_Range> ip6_blocks;
+   EXPECT_THROW( append_cidr_blocks( IP6_Range::from_start_and_end_addresses( 5, 1 ), ip6_blocks ), std::invalid_argument );
+   EXPECT_TRUE( ip6_blocks.empty() );
+
+   Table_Line_Processor processor( true );
+   std::string output;
+   EXPECT_ANY_THROW( processor.process_line( "a:10.0.0.5-10.0.0.1", output ) );
+}
+
+TEST(CIDR_Blocks, test_format_cidr_block_writes_prefix) {
+   char buffer[IP_Range::max_string_length];
+   IP_Range block = IP_Range::from_start_and_end_addresses( 0x01020304, 0x01020304 );
+   EXPECT_EQ( "1.2.3.4/32", std::string( buffer, format_cidr_block( buffer, block ) ) );
+
+   block = IP_Range::from_start_and_end_addresses( 0, 0xffffffff );
+   EXPECT_EQ( "0.0.0.0/0", std::string( buffer, format_cidr_block( buffer, block ) ) );
+
+   char ip6_buffer[max_ip6_range_string_length];
+   EXPECT_EQ( "::1/128", std::string( ip6_buffer, format_cidr_block( ip6_buffer, parse_ip6_range( "::1" ) ) ) );
+   EXPECT_EQ( "2001:db8::/32", std::string( ip6_buffer, format_cidr_block( ip6_buffer, parse_ip6_range( "2001:db8::/32" ) ) ) );
+}
+
+TEST(Table_Line_Processor, test_cidr_only) {
+   Table_Line_Processor processor( true );
+   std::string output;
+   processor.process_line( "a:10.0.0.1-10.0.0.6,192.168.0.0/16", output );
+   EXPECT_EQ( "a:10.0.0.1/32,10.0.0.2/31,10.0.0.4/31,10.0.0.6/32,192.168.0.0/16", output );
+
+   output.clear();
+   EXPECT_THROW( processor.process_line( "b:10.0.0.1,1.2.3.4/255.0.255.0", output ), std::invalid_argument );
+}
+
+TEST(Coalescing_IP_Range_Set_Lookup, test_find_and_contains) {
+   Coalescing_IP_Range_Set set;
+   set.insert( IP_Range::from_start_and_end_addresses( 10, 20 ) );
+   set.insert( IP_Range::from_start_and_end_addresses( 30, 30 ) );
+   set.insert( IP_Range::from_start_and_end_addresses( 0xfffffff0, 0xffffffff ) );
+   IP_Range noncontiguous;
+   noncontiguous.from_string( "0.0.0.25/255.0.255.0" );
+   set.insert( noncontiguous );
+
+   EXPECT_TRUE( set.find( 9 ) == set.end() );
+   ASSERT_TRUE( set.find( 10 ) != set.end() );
+   EXPECT_EQ( 20u, set.find( 15 )->get_end_address() );
+   EXPECT_EQ( 10u, set.find( 20 )->get_start_address() );
+   EXPECT_FALSE( set.contains( 21u ) );
+   EXPECT_FALSE( set.contains( 25u ) );
+   EXPECT_TRUE( set.contains( 30u ) );
+   EXPECT_FALSE( set.contains( 31u ) );
+   EXPECT_TRUE( set.contains( 0xffffffffu ) );
+   EXPECT_FALSE( set.contains( 0u ) );
+
+   EXPECT_TRUE( set.contains( IP_Range::from_start_and_end_addresses( 10, 20 ) ) );
+   EXPECT_TRUE( set.contains( IP_Range::from_start_and_end_addresses( 12, 14 ) ) );
+   EXPECT_FALSE( set.contains( IP_Range::from_start_and_end_addresses( 12, 21 ) ) );
+   EXPECT_FALSE( set.contains( IP_Range::from_start_and_end_addresses( 20, 30 ) ) );
+   EXPECT_FALSE( set.contains( noncontiguous ) );
+
+   EXPECT_FALSE( Coalescing_IP_Range_Set().contains( 0u ) );
+}
+
+TEST(Coalescing_IP_Range_Set_Lookup, test_lookups_match_linear_search) {
+   std::vector<IP_Range> ranges = external_coalescer_test_ranges( 2000 );
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::vector<IP_Range>( ranges ) );
+
+   auto linear_contains = [&]( uint32_t address )
+   {
+      for( const IP_Range & range : set )
+      {
+         if( range.has_contiguous_subnet_mask() &&
+             (range.get_start_address() <= address) && (address <= range.get_end_address()) )
+         {
+            return true;
+         }
+      }
+      return false;
+   };
+
+   std::vector<uint32_t> addresses;
+   for( uint32_t address = 0; address < 201000; address += 7 )
+   {
+      addresses.push_back( address );
+   }
+
+   std::vector<bool> results;
+   set.contains( addresses, results );
+   ASSERT_EQ( addresses.size(), results.size() );
+
+   for( std::size_t i = 0; i < addresses.size(); i++ )
+   {
+      bool expected = linear_contains( addresses[i] );
+      ASSERT_EQ( expected, set.contains( addresses[i] ) ) << addresses[i];
+      ASSERT_EQ( expected, results[i] ) << addresses[i];
+   }
+}
+
+TEST(DIR_24_8_Table, test_contains_matches_set) {
+   std::vector<IP_Range> ranges = {
+      IP_Range::from_start_and_end_addresses( 0x0a000005, 0x0a000005 ),
+      IP_Range::from_start_and_end_addresses( 0x0a000010, 0x0a0000ff ),
+      IP_Range::from_start_and_end_addresses( 0x0a000180, 0x0a0305ff ),
+      IP_Range::from_start_and_end_addresses( 0x0b000000, 0x0b0000ff ),
+      IP_Range::from_start_and_end_addresses( 0xffffff00, 0xffffffff ),
+   };
+   IP_Range noncontiguous;
+   noncontiguous.from_string( "12.0.0.1/255.0.255.255" );
+   ranges.push_back( noncontiguous );
+
+   // Plenty of ranges sharing /24s with each other.
+   std::vector<IP_Range> random_ranges = external_coalescer_test_ranges( 5000 );
+   ranges.insert( ranges.end(), random_ranges.begin(), random_ranges.end() );
+
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+   DIR_24_8_Table table = DIR_24_8_Table::build( set );
+
+   EXPECT_GE( table.memory_bytes(), (std::size_t( 1 ) << 24) * sizeof(uint32_t) );
+   EXPECT_GT( table.chunk_count(), 0u );
+
+   std::vector<uint32_t> addresses = { 0, 0x0a000004, 0x0a000005, 0x0a000006, 0x0a00000f, 0x0a000010,
+                                       0x0a0000ff, 0x0a000100, 0x0a00017f, 0x0a000180, 0x0a0305ff,
+                                       0x0a030600, 0x0b000000, 0x0b0000ff, 0x0b000100, 0x0c000001,
+                                       0xfffffeff, 0xffffff00, 0xffffffff };
+   for( uint32_t address = 0; address < 201000; address++ )
+   {
+      addresses.push_back( address );
+   }
+
+   for( uint32_t address : addresses )
+   {
+      ASSERT_EQ( set.contains( address ), table.contains( address ) ) << to_dotted_octet( address );
+   }
+}
+
+TEST(DIR_24_8_Table, test_empty_set) {
+   DIR_24_8_Table table = DIR_24_8_Table::build( Coalescing_IP_Range_Set() );
+   EXPECT_FALSE( table.contains( 0 ) );
+   EXPECT_FALSE( table.contains( 0xffffffff ) );
+   EXPECT_EQ( 0u, table.chunk_count() );
+}
+
+static_assert( prefix_length_to_mask<uint32_t>( 0 ) == 0 );
+static_assert( prefix_length_to_mask<uint32_t>( 24 ) == 0xffffff00 );
+static_assert( prefix_length_to_mask<IP6_Address>( 128 ) == ~IP6_Address( 0 ) );
+static_assert( prefix_length_to_mask<IP6_Address>( 64 ) == (~IP6_Address( 0 ) << 64) );
+static_assert( count_leading_zeros( IP6_Address( 1 ) ) == 127 );
+static_assert( count_trailing_zeros( IP6_Address( 1 ) << 100 ) == 100 );
+static_assert( IP6_Range::from_subnet( IP6_Address( 0x20010db8 ) << 96, 32 ).prefix_length() == 32 );
+static_assert( IP6_Range::from_subnet( 0, 0 ).get_end_address() == ~IP6_Address( 0 ) );
+static_assert( !IP6_Range::from_start_and_end_addresses( 1, 4 ).is_subnet() );
+static_assert( IP6_Range::from_start_and_end_addresses( 0, 4 ).is_coalescable( IP6_Range::from_start_and_end_addresses( 5, 9 ) ) );
+static_assert( !IP6_Range::from_start_and_end_addresses( 0, 4 ).is_coalescable( IP6_Range::from_start_and_end_addresses( 6, 9 ) ) );
+
+static IP6_Address ip6_address( uint64_t high, uint64_t low )
+{
+   return (IP6_Address( high ) << 64) | low;
+}
+
+TEST(IP6_Range, test_parse_and_format_round_trip) {
+   const char * canonical[] = {
+      "::",
+      "::1",
+      "1::",
+      "2001:db8::/32",
+      "2001:db8::1",
+      "2001:db8:0:1:1:1:1:1",
+      "2001:0:0:1::1",
+      "2001:db8::1:0:0:1",
+      "fe80::/10",
+      "::ffff:102:304",
+      "1:2:3:4:5:6:7:8",
+      "::/0",
+      "2001:db8::5-2001:db8::9",
+   };
+
+   for( const char * str : canonical )
+   {
+      EXPECT_EQ( std::string( str ), to_string( parse_ip6_range( str ) ) );
+   }
+}
+
+TEST(IP6_Range, test_parse_noncanonical_forms) {
+   EXPECT_EQ( "2001:db8::1", to_string( parse_ip6_range( "2001:DB8:0000:0:0:0:0:0001" ) ) );
+   EXPECT_EQ( "::ffff:102:304", to_string( parse_ip6_range( "::ffff:1.2.3.4" ) ) );
+   EXPECT_EQ( "2001:db8::/32", to_string( parse_ip6_range( "2001:db8:1234::5/32" ) ) );
+   EXPECT_EQ( "2001:db8::1", to_string( parse_ip6_range( "2001:db8::1/128" ) ) );
+   EXPECT_EQ( "2001:db8::1", to_string( parse_ip6_range( "2001:db8::1-2001:db8::1" ) ) );
+
+   IP6_Range range = parse_ip6_range( "2001:db8::/32" );
+   EXPECT_EQ( ip6_address( 0x20010db800000000, 0 ), range.get_start_address() );
+   EXPECT_EQ( ip6_address( 0x20010db8ffffffff, 0xffffffffffffffff ), range.get_end_address() );
+}
+
+TEST(IP6_Range, test_parse_invalid_forms) {
+   const char * invalid[] = {
+      "", ":", ":::", "1:::2", "1::2::3", "12345::", "g::", "1:2:3:4:5:6:7", "1:2:3:4:5:6:7:8:9",
+      "1:2:3:4:5:6:7:8::", "::/129", "::/", "::/-1", "::2-::1", "::1-", "::1.2.3", "::1.2.3.256",
+      "1.2.3.4", "::1 ",
+   };
+
+   for( const char * str : invalid )
+   {
+      IP6_Range range = IP6_Range::from_start_and_end_addresses( 7, 9 );
+      EXPECT_FALSE( try_parse_ip6_range( str, range ) ) << str;
+      EXPECT_EQ( IP6_Range::from_start_and_end_addresses( 7, 9 ), range ) << str;
+      EXPECT_THROW( parse_ip6_range( str ), std::runtime_error ) << str;
+   }
+}
+
+TEST(IP6_Range, test_sort_and_coalesce) {
+   std::vector<IP6_Range> ranges = {
+      parse_ip6_range( "2001:db8:8000::/33" ),
+      parse_ip6_range( "::1" ),
+      parse_ip6_range( "2001:db8::/33" ),
+      parse_ip6_range( "::" ),
+      parse_ip6_range( "2001:db8::5-2001:db8::9" ),
+      parse_ip6_range( "::3" ),
+      parse_ip6_range( "ffff:ffff:ffff:ffff:ffff:ffff:ffff:fffe-ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff" ),
+      parse_ip6_range( "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ff00/120" ),
+   };
+
+   sort_and_coalesce( ranges );
+
+   std::vector<std::string> strings;
+   for( const IP6_Range & range : ranges )
+   {
+      strings.push_back( to_string( range ) );
+   }
+
+   std::vector<std::string> expected = { "::/127", "::3", "2001:db8::/32", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ff00/120" };
+   EXPECT_EQ( expected, strings );
+}
+
+TEST(IP6_Range, test_append_cidr_blocks) {
+   std::vector<IP6_Range> blocks;
+   append_cidr_blocks( parse_ip6_range( "2001:db8::3-2001:db8::9" ), blocks );
+
+   std::vector<std::string> strings;
+   for( const IP6_Range & block : blocks )
+   {
+      strings.push_back( to_string( block ) );
+   }
+
+   std::vector<std::string> expected = { "2001:db8::3", "2001:db8::4/126", "2001:db8::8/127" };
+   EXPECT_EQ( expected, strings );
+
+   blocks.clear();
+   append_cidr_blocks( parse_ip6_range( "::/0" ), blocks );
+   ASSERT_EQ( 1u, blocks.size() );
+   EXPECT_EQ( "::/0", to_string( blocks[0] ) );
+}
+
+TEST(IP6_Range, test_parse_mixed_ranges) {
+   std::vector<IP_Range> ranges;
+   std::vector<IP6_Range> ip6_ranges;
+   parse_ranges( "10.0.0.0/8 2001:db8::/32\n::1\t1.2.3.4-1.2.3.5 ::ffff:1.2.3.4\n", ranges, ip6_ranges );
+
+   ASSERT_EQ( 2u, ranges.size() );
+   EXPECT_EQ( "10.0.0.0/8", ranges[0].to_string() );
+   EXPECT_EQ( "1.2.3.4/31", ranges[1].to_string() );
+
+   ASSERT_EQ( 3u, ip6_ranges.size() );
+   EXPECT_EQ( "2001:db8::/32", to_string( ip6_ranges[0] ) );
+   EXPECT_EQ( "::1", to_string( ip6_ranges[1] ) );
+   EXPECT_EQ( "::ffff:102:304", to_string( ip6_ranges[2] ) );
+
+   EXPECT_THROW( parse_ranges( "10.0.0.0/8 bogus", ranges, ip6_ranges ), std::runtime_error );
+}
+
+TEST(IP6_Range, test_ipv4_only_parse_rejects_ipv6) {
+   std::vector<IP_Range> ranges;
+   EXPECT_THROW( parse_ranges( "10.0.0.0/8 ::1", ranges ), std::runtime_error );
+}
+
+static_assert( is_on_or_adjacent_unchecked<IP6_Address>( ~IP6_Address( 0 ), 0, ~IP6_Address( 0 ) ) &&
+               !is_on_or_adjacent_unchecked<IP6_Address>( IP6_Address( 1 ) << 64, 0, (IP6_Address( 1 ) << 64) - 2 ),
+               "IPv6 adjacency" );
+
+TEST(IP6_Range, test_ipv4_shares_the_basic_range_algorithms) {
+   using IP4_Range = Basic_IP_Range<uint32_t>;
+
+   std::srand( 18 );
+
+   std::vector<IP_Range> ranges;
+   std::vector<IP4_Range> basic_ranges;
+
+   for( int i = 0; i < 2000; i++ )
+   {
+      uint32_t start = (i == 0) ? 0 : (i == 1) ? 0xffffff00 : static_cast<uint32_t>(std::rand()) % 100000;
+      uint32_t end = (i == 1) ? 0xffffffff : start + static_cast<uint32_t>(std::rand()) % 300;
+
+      ranges.push_back( IP_Range::from_start_and_end_addresses( start, end ) );
+      basic_ranges.push_back( IP4_Range::from_start_and_end_addresses( start, end ) );
+   }
+
+   sort_and_coalesce( ranges );
+   sort_and_coalesce( basic_ranges );
+
+   ASSERT_EQ( basic_ranges.size(), ranges.size() );
+
+   std::vector<IP_Range> blocks;
+   std::vector<IP4_Range> basic_blocks;
+
+   for( std::size_t i = 0; i < ranges.size(); i++ )
+   {
+      EXPECT_EQ( basic_ranges[i].get_start_address(), ranges[i].get_start_address() );
+      EXPECT_EQ( basic_ranges[i].get_end_address(), ranges[i].get_end_address() );
+
+      append_cidr_blocks( ranges[i], blocks );
+      append_cidr_blocks( basic_ranges[i], basic_blocks );
+   }
+
+   ASSERT_EQ( basic_blocks.size(), blocks.size() );
+
+   for( std::size_t i = 0; i < blocks.size(); i++ )
+   {
+      EXPECT_TRUE( basic_blocks[i].is_subnet() );
+      EXPECT_EQ( basic_blocks[i].get_start_address(), blocks[i].get_start_address() );
+      EXPECT_EQ( basic_blocks[i].get_end_address(), blocks[i].get_end_address() );
+   }
+}
+
+TEST(IP6_Range, test_range_reader_in_small_chunks) {
+   const char text[] = "10.0.0.0/8\n2001:db8::/32\n::1\n1.2.3.4\nfe80::1-fe80::ff\n";
+
+   for( std::size_t chunk_size : { 1, 7, 4096 } )
+   {
+      int fds[2];
+      ASSERT_EQ( 0, pipe( fds ) );
+      ASSERT_EQ( static_cast<ssize_t>(strlen(text)), write( fds[1], text, strlen(text) ) );
+      close( fds[1] );
+
+      std::vector<IP_Range> ranges;
+      std::vector<IP6_Range> ip6_ranges;
+      {
+         Range_Reader reader( fds[0], chunk_size );
+         reader.read_all( ranges, ip6_ranges );
+      }
+      close( fds[0] );
+
+      EXPECT_EQ( 2u, ranges.size() ) << "chunk_size=" << chunk_size;
+      ASSERT_EQ( 3u, ip6_ranges.size() ) << "chunk_size=" << chunk_size;
+      EXPECT_EQ( "fe80::1-fe80::ff", to_string( ip6_ranges[2] ) );
+   }
+}
+
+static Coalescing_IP_Range_Set set_algebra_test_set( unsigned seed )
+{
+   std::srand( seed );
+
+   std::vector<IP_Range> ranges;
+   for( int i = 0; i < 40; i++ )
+   {
+      uint32_t start = std::rand() % 2048;
+      ranges.push_back( IP_Range::from_start_and_end_addresses( start, start + (std::rand() % 64) ) );
+   }
+
+   return Coalescing_IP_Range_Set::build( std::move(ranges) );
+}
+
+static void expect_coalesced( const Coalescing_IP_Range_Set & set )
+{
+   const IP_Range * prev = nullptr;
+   for( const IP_Range & range : set )
+   {
+      if( prev )
+      {
+         EXPECT_LT( static_cast<uint64_t>(prev->get_end_address()) + 1, range.get_start_address() ) << prev->to_string() << " " << range.to_string();
+      }
+      prev = &range;
+   }
+}
+
+TEST(Set_Algebra, test_operations_match_per_address_membership) {
+   for( unsigned seed = 1; seed <= 20; seed++ )
+   {
+      Coalescing_IP_Range_Set a = set_algebra_test_set( seed );
+      Coalescing_IP_Range_Set b = set_algebra_test_set( seed + 1000 );
+
+      Coalescing_IP_Range_Set a_union_b = set_union( a, b );
+      Coalescing_IP_Range_Set a_intersect_b = set_intersection( a, b );
+      Coalescing_IP_Range_Set a_minus_b = set_difference( a, b );
+      Coalescing_IP_Range_Set not_a = complement( a );
+
+      for( const Coalescing_IP_Range_Set * set : { &a_union_b, &a_intersect_b, &a_minus_b, &not_a } )
+      {
+         expect_coalesced( *set );
+      }
+
+      for( uint32_t address = 0; address < 2200; address++ )
+      {
+         ASSERT_EQ( a.contains( address ) || b.contains( address ), a_union_b.contains( address ) ) << seed << " " << address;
+         ASSERT_EQ( a.contains( address ) && b.contains( address ), a_intersect_b.contains( address ) ) << seed << " " << address;
+         ASSERT_EQ( a.contains( address ) && !b.contains( address ), a_minus_b.contains( address ) ) << seed << " " << address;
+         ASSERT_EQ( !a.contains( address ), not_a.contains( address ) ) << seed << " " << address;
+      }
+
+      EXPECT_TRUE( not_a.contains( 0xffffffff ) );
+   }
+}
+
+TEST(Set_Algebra, test_complement_at_ends_of_address_space) {
+   Coalescing_IP_Range_Set empty;
+   Coalescing_IP_Range_Set all = complement( empty );
+   ASSERT_EQ( 1, all.size() );
+   EXPECT_EQ( "0.0.0.0/0", all.begin()->to_string() );
+   EXPECT_EQ( 0, complement( all ).size() );
+
+   std::vector<IP_Range> ranges = { IP_Range( 0, 0xff000000 ), IP_Range( 0xff000000, 0xff000000 ) };
+   Coalescing_IP_Range_Set ends = Coalescing_IP_Range_Set::build( std::move(ranges) );
+   Coalescing_IP_Range_Set middle = complement( ends );
+   ASSERT_EQ( 1, middle.size() );
+   EXPECT_EQ( "1.0.0.0-254.255.255.255", middle.begin()->to_string() );
+}
+
+TEST(Set_Algebra, test_noncontiguous_ranges_take_part_as_a_whole) {
+   IP_Range pattern( 0x01020304, 0xff00ff00 );
+   IP_Range other_pattern( 0x05060708, 0xff00ff00 );
+
+   std::vector<IP_Range> a_ranges = { pattern, other_pattern, IP_Range( 0x0a000000, 0xff000000 ) };
+   std::vector<IP_Range> b_ranges = { pattern, IP_Range( 0x0a000000, 0xffff0000 ) };
+   Coalescing_IP_Range_Set a = Coalescing_IP_Range_Set::build( std::move(a_ranges) );
+   Coalescing_IP_Range_Set b = Coalescing_IP_Range_Set::build( std::move(b_ranges) );
+
+   auto strings = []( const Coalescing_IP_Range_Set & set ) {
+      std::vector<std::string> result;
+      for( const IP_Range & range : set ) result.push_back( range.to_string() );
+      return result;
+   };
+
+   EXPECT_EQ( std::vector<std::string>( { "1.2.3.4/255.0.255.0", "5.6.7.8/255.0.255.0", "10.0.0.0/8" } ), strings( set_union( a, b ) ) );
+   EXPECT_EQ( std::vector<std::string>( { "1.2.3.4/255.0.255.0", "10.0.0.0/16" } ), strings( set_intersection( a, b ) ) );
+   EXPECT_EQ( std::vector<std::string>( { "5.6.7.8/255.0.255.0", "10.1.0.0-10.255.255.255" } ), strings( set_difference( a, b ) ) );
+   EXPECT_EQ( std::vector<std::string>( { "0.0.0.0-9.255.255.255", "11.0.0.0-255.255.255.255" } ), strings( complement( a ) ) );
+}
+
+TEST(Set_Algebra, test_ip6_range_lists) {
+   std::vector<IP6_Range> a = { parse_ip6_range( "::/1" ) };
+   std::vector<IP6_Range> b = { parse_ip6_range( "::1-::5" ), parse_ip6_range( "8000::/1" ) };
+
+   std::vector<IP6_Range> result;
+   append_union( a, b, result );
+   ASSERT_EQ( 1u, result.size() );
+   EXPECT_EQ( "::/0", to_string( result[0] ) );
+
+   result.clear();
+   append_difference( a, b, result );
+   ASSERT_EQ( 2u, result.size() );
+   EXPECT_EQ( "::", to_string( result[0] ) );
+   EXPECT_EQ( "::6-7fff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", to_string( result[1] ) );
+
+   result.clear();
+   append_complement( b, result );
+   ASSERT_EQ( 2u, result.size() );
+   EXPECT_EQ( "::", to_string( result[0] ) );
+   EXPECT_EQ( "::6-7fff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", to_string( result[1] ) );
+}
+
+static std::string snapshot_test_path()
+{
+   char path[] = "/tmp/ip_coalesce_snapshot_XXXXXX";
+   int fd = mkstemp( path );
+   close( fd );
+   return path;
+}
+
+TEST(IP_Range_Snapshot, test_round_trip_matches_set) {
+   std::vector<IP_Range> ranges = external_coalescer_test_ranges( 5000 );
+   ranges.push_back( IP_Range( 0x01020304, 0xff00ff00 ) );
+   ranges.push_back( IP_Range( 0xff000000, 0xff000000 ) );
+   ranges.push_back( IP_Range( 0, 0xffffff00 ) );
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   std::string path = snapshot_test_path();
+   save_snapshot( path, set );
+
+   IP_Range_Snapshot snapshot( path );
+   EXPECT_EQ( static_cast<std::size_t>(set.size()), snapshot.size() );
+
+   std::vector<IP_Range> loaded;
+   snapshot.for_each( [&]( const IP_Range & range ) { loaded.push_back( range ); } );
+
+   std::vector<std::string> expected_strings, loaded_strings;
+   for( const IP_Range & range : set ) expected_strings.push_back( range.to_string() );
+   for( const IP_Range & range : loaded ) loaded_strings.push_back( range.to_string() );
+   EXPECT_EQ( expected_strings, loaded_strings );
+
+   Coalescing_IP_Range_Set loaded_set = snapshot.to_set();
+   loaded_strings.clear();
+   for( const IP_Range & range : loaded_set ) loaded_strings.push_back( range.to_string() );
+   EXPECT_EQ( expected_strings, loaded_strings );
+
+   for( uint32_t address : { 0u, 0xffu, 0x100u, 0x01020304u, 0xfeffffffu, 0xff000000u, 0xffffffffu } )
+   {
+      EXPECT_EQ( set.contains( address ), snapshot.contains( address ) ) << to_dotted_octet( address );
+   }
+   for( uint32_t address = 0; address < 201000; address++ )
+   {
+      ASSERT_EQ( set.contains( address ), snapshot.contains( address ) ) << to_dotted_octet( address );
+   }
+
+   unlink( path.c_str() );
+}
+
+TEST(IP_Range_Snapshot, test_empty_set) {
+   std::string path = snapshot_test_path();
+   save_snapshot( path, Coalescing_IP_Range_Set() );
+
+   IP_Range_Snapshot snapshot( path );
+   EXPECT_EQ( 0u, snapshot.size() );
+   EXPECT_FALSE( snapshot.contains( 0 ) );
+   EXPECT_EQ( 0, snapshot.to_set().size() );
+
+   unlink( path.c_str() );
+}
+
+TEST(IP_Range_Snapshot, test_writer_rejects_unordered_ranges) {
+   std::string path = snapshot_test_path();
+   Snapshot_Writer writer( path );
+
+   writer.add( IP_Range::from_start_and_end_addresses( 10, 20 ) );
+   EXPECT_THROW( writer.add( IP_Range::from_start_and_end_addresses( 21, 30 ) ), std::invalid_argument );
+   EXPECT_THROW( writer.add( IP_Range::from_start_and_end_addresses( 5, 8 ) ), std::invalid_argument );
+   writer.add( IP_Range::from_start_and_end_addresses( 22, 30 ) );
+
+   unlink( path.c_str() );
+}
+
+TEST(IP_Range_Snapshot, test_rewrite_in_place_while_loaded) {
+   std::string path = snapshot_test_path();
+
+   std::vector<IP_Range> ranges = { IP_Range( 0x0a000000, 0xff000000 ), IP_Range( 0xc0a80000, 0xffff0000 ) };
+   save_snapshot( path, Coalescing_IP_Range_Set::build( std::move(ranges) ) );
+
+   // Unfinished, the old snapshot stays.
+   {
+      Snapshot_Writer writer( path );
+      writer.add( IP_Range::from_start_and_end_addresses( 10, 20 ) );
+   }
+   EXPECT_EQ( 2u, IP_Range_Snapshot( path ).size() );
+
+   // Streamed from the mapping of the file it replaces.
+   {
+      IP_Range_Snapshot snapshot( path );
+      Snapshot_Writer writer( path );
+      writer.add( IP_Range::from_start_and_end_addresses( 1, 2 ) );
+      snapshot.for_each( [&]( const IP_Range & range ) { writer.add( range ); } );
+      writer.finish();
+      EXPECT_EQ( 2u, snapshot.size() );
+   }
+
+   IP_Range_Snapshot snapshot( path );
+   EXPECT_EQ( 3u, snapshot.size() );
+   EXPECT_TRUE( snapshot.contains( 0x0a010203u ) );
+   EXPECT_TRUE( snapshot.contains( 2u ) );
+
+   unlink( path.c_str() );
+}
+
+TEST(IP_Range_Snapshot, test_open_rejects_invalid_files) {
+   std::string path = snapshot_test_path();
+
+   // Empty file.
+   EXPECT_THROW( IP_Range_Snapshot snapshot( path ), std::runtime_error );
+
+   // Text file.
+   {
+      FILE * file = fopen( path.c_str(), "w" );
+      fputs( "10.0.0.0/8 192.168.0.0/16 172.16.0.0/12\n", file );
+      fclose( file );
+   }
+   EXPECT_THROW( IP_Range_Snapshot snapshot( path ), std::runtime_error );
+
+   // An unfinished snapshot leaves the text file in place.
+   {
+      Snapshot_Writer writer( path );
+      writer.add( IP_Range::from_start_and_end_addresses( 10, 20 ) );
+   }
+   EXPECT_THROW( IP_Range_Snapshot snapshot( path ), std::runtime_error );
+
+   // Truncated snapshot.
+   std::vector<IP_Range> ranges = { IP_Range( 0x0a000000, 0xff000000 ), IP_Range( 0xc0a80000, 0xffff0000 ) };
+   save_snapshot( path, Coalescing_IP_Range_Set::build( std::move(ranges) ) );
+   EXPECT_NO_THROW( IP_Range_Snapshot snapshot( path ) );
+   ASSERT_EQ( 0, truncate( path.c_str(), sizeof(Snapshot_Header) + sizeof(Snapshot_Range) ) );
+   EXPECT_THROW( IP_Range_Snapshot snapshot( path ), std::runtime_error );
+
+   unlink( path.c_str() );
+   EXPECT_THROW( IP_Range_Snapshot snapshot( path ), std::system_error );
+}
+
+static std::vector<std::string> range_strings( const Coalescing_IP_Range_Set & set )
+{
+   std::vector<std::string> strings;
+   for( const IP_Range & range : set )
+   {
+      strings.push_back( range.to_string() );
+   }
+   return strings;
+}
+
+TEST(Coalescing_IP_Range_Set, test_erase_trims_and_splits_ranges) {
+   std::vector<IP_Range> ranges = { IP_Range( 0x0a000000, 0xff000000 ), IP_Range( 0x0c000000, 0xff000000 ),
+                                    IP_Range( 0x01020304, 0xff00ff00 ) };
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   set.erase( IP_Range( 0x0a010000, 0xffff0000 ) );
+   EXPECT_EQ( std::vector<std::string>( { "1.2.3.4/255.0.255.0", "10.0.0.0/16", "10.2.0.0-10.255.255.255", "12.0.0.0/8" } ), range_strings( set ) );
+
+   set.erase( IP_Range::from_start_and_end_addresses( 0x0a800000, 0x0c7fffff ) );
+   EXPECT_EQ( std::vector<std::string>( { "1.2.3.4/255.0.255.0", "10.0.0.0/16", "10.2.0.0-10.127.255.255", "12.128.0.0/9" } ), range_strings( set ) );
+
+   // Erasing a contiguous range leaves patterns, and erasing a pattern leaves
+   // the contiguous ranges it overlaps.
+   set.erase( IP_Range( 0, 0xfe000000 ) );
+   EXPECT_EQ( std::vector<std::string>( { "1.2.3.4/255.0.255.0", "10.0.0.0/16", "10.2.0.0-10.127.255.255", "12.128.0.0/9" } ), range_strings( set ) );
+
+   set.erase( IP_Range( 0x0a000000, 0xff00ff00 ) );
+   EXPECT_EQ( 4, set.size() );
+
+   set.erase( IP_Range( 0x01020304, 0xff00ff00 ) );
+   EXPECT_EQ( std::vector<std::string>( { "10.0.0.0/16", "10.2.0.0-10.127.255.255", "12.128.0.0/9" } ), range_strings( set ) );
+
+   set.erase( IP_Range::from_start_and_end_addresses( 0x0a000000, 0x0a7fffff ) );
+   EXPECT_EQ( std::vector<std::string>( { "12.128.0.0/9" } ), range_strings( set ) );
+
+   set.erase( IP_Range( 0, 0 ) );
+   EXPECT_EQ( 0, set.size() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_erase_keeps_piece_with_bounds_of_a_pattern) {
+   // The pattern's bounds are those of the piece 10.0.0.4 left by erasing
+   // 10.0.0.5, and the contiguous piece takes its place, as in build().
+   std::vector<IP_Range> ranges = { IP_Range( 0x0a000004, 0xfffffffc ), IP_Range( 0x0a000004, 0xffff00ff ) };
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+   ASSERT_EQ( 2, set.size() );
+
+   set.erase( IP_Range::from_start_and_end_addresses( 0x0a000005, 0x0a000005 ) );
+   EXPECT_EQ( std::vector<std::string>( { "10.0.0.4", "10.0.0.6/31" } ), range_strings( set ) );
+   EXPECT_TRUE( set.contains( 0x0a000004u ) );
+
+   std::vector<IP_Range> expected = { IP_Range::from_start_and_end_addresses( 0x0a000004, 0x0a000004 ),
+                                      IP_Range( 0x0a000004, 0xffff00ff ),
+                                      IP_Range::from_start_and_end_addresses( 0x0a000006, 0x0a000007 ) };
+   EXPECT_EQ( range_strings( Coalescing_IP_Range_Set::build( std::move(expected) ) ), range_strings( set ) );
+
+   // Inserting a contiguous range with a pattern's bounds replaces it too.
+   set = Coalescing_IP_Range_Set::build( { IP_Range( 0x0a000004, 0xffff00ff ) } );
+   set.insert( IP_Range::from_start_and_end_addresses( 0x0a000004, 0x0a000004 ) );
+   EXPECT_EQ( std::vector<std::string>( { "10.0.0.4" } ), range_strings( set ) );
+}
+
+TEST(Range_Delta, test_parse_range_changes) {
+   std::vector<Range_Change> changes;
+   std::vector<IP6_Range_Change> ip6_changes;
+   parse_range_changes( "+10.0.0.0/8\n-10.1.0.0/16 +2001:db8::/32\n\n-::1\n", changes, ip6_changes );
+
+   ASSERT_EQ( 2u, changes.size() );
+   EXPECT_TRUE( changes[0].is_addition );
+   EXPECT_EQ( "10.0.0.0/8", changes[0].range.to_string() );
+   EXPECT_FALSE( changes[1].is_addition );
+   EXPECT_EQ( "10.1.0.0/16", changes[1].range.to_string() );
+
+   ASSERT_EQ( 2u, ip6_changes.size() );
+   EXPECT_TRUE( ip6_changes[0].is_addition );
+   EXPECT_FALSE( ip6_changes[1].is_addition );
+   EXPECT_EQ( "::1", to_string( ip6_changes[1].range ) );
+
+   for( const char * text : { "10.0.0.0/8", "+", "-", "+bogus", "*10.0.0.0/8" } )
+   {
+      EXPECT_THROW( parse_range_changes( text, changes, ip6_changes ), std::runtime_error ) << text;
+   }
+}
+
+TEST(Range_Delta, test_apply_range_changes_in_order) {
+   std::vector<Range_Change> changes;
+   std::vector<IP6_Range_Change> ip6_changes;
+   parse_range_changes( "-10.1.0.0/16 +11.0.0.0/8 +10.1.2.3 -192.168.0.0/16 +192.168.1.0/24 "
+                        "+2001:db9::/32 -2001:db8::1",
+                        changes, ip6_changes );
+
+   std::vector<IP_Range> ranges = { IP_Range( 0x0a000000, 0xff000000 ), IP_Range( 0xc0a80000, 0xffff0000 ) };
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+   apply_range_changes( changes, set );
+   EXPECT_EQ( std::vector<std::string>( { "10.0.0.0/16", "10.1.2.3", "10.2.0.0-11.255.255.255", "192.168.1.0/24" } ), range_strings( set ) );
+
+   std::vector<IP6_Range> ip6_ranges = { parse_ip6_range( "2001:db8::/32" ) };
+   apply_range_changes( ip6_changes, ip6_ranges );
+   ASSERT_EQ( 2u, ip6_ranges.size() );
+   EXPECT_EQ( "2001:db8::", to_string( ip6_ranges[0] ) );
+   EXPECT_EQ( "2001:db8::2-2001:db9:ffff:ffff:ffff:ffff:ffff:ffff", to_string( ip6_ranges[1] ) );
+}
+
+TEST(Coalescing_IP_Range_Set, test_erase_address) {
+   std::vector<IP_Range> ranges = { IP_Range::from_start_and_end_addresses( 0, 3 ),
+                                    IP_Range::from_start_and_end_addresses( 10, 20 ),
+                                    IP_Range::from_start_and_end_addresses( 0xfffffffe, 0xffffffff ) };
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   set.erase( 0u );
+   set.erase( 15u );
+   set.erase( 10u );
+   set.erase( 20u );
+   set.erase( 7u );
+   set.erase( 0xffffffffu );
+
+   EXPECT_EQ( std::vector<std::string>( { "0.0.0.1-0.0.0.3", "0.0.0.11-0.0.0.14", "0.0.0.16/30", "255.255.255.254" } ),
+              range_strings( set ) );
+
+   set.erase( 0xfffffffeu );
+   EXPECT_EQ( 3, set.size() );
+}
+
+TEST(Coalescing_IP_Range_Set, test_erase_address_keeps_piece_with_bounds_of_a_pattern) {
+   std::vector<IP_Range> ranges = { IP_Range( 0x0a000004, 0xfffffffc ), IP_Range( 0x0a000004, 0xffff00ff ),
+                                    IP_Range( 0x0a000007, 0xffff00ff ) };
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   set.erase( 0x0a000005u );
+   EXPECT_TRUE( set.contains( 0x0a000004u ) );
+   EXPECT_FALSE( set.contains( 0x0a000005u ) );
+   EXPECT_EQ( std::vector<std::string>( { "10.0.0.4", "10.0.0.6/31", "10.0.0.7/255.255.0.255" } ), range_strings( set ) );
+
+   set.erase( 0x0a000006u );
+   EXPECT_TRUE( set.contains( 0x0a000007u ) );
+   EXPECT_EQ( std::vector<std::string>( { "10.0.0.4", "10.0.0.7" } ), range_strings( set ) );
+}
+
+TEST(Coalescing_IP_Range_Set, test_erase_matches_per_address_membership) {
+   for( unsigned seed = 1; seed <= 20; seed++ )
+   {
+      Coalescing_IP_Range_Set set = set_algebra_test_set( seed );
+      std::vector<bool> expected( 2200 );
+      for( uint32_t address = 0; address < expected.size(); address++ )
+      {
+         expected[address] = set.contains( address );
+      }
+
+      for( int i = 0; i < 30; i++ )
+      {
+         uint32_t start = std::rand() % 2100;
+         uint32_t end = start + (std::rand() % 100);
+
+         if( i % 3 == 0 )
+         {
+            set.erase( start );
+            expected[start] = false;
+         }
+         else
+         {
+            set.erase( IP_Range::from_start_and_end_addresses( start, end ) );
+            std::fill( expected.begin() + start, expected.begin() + end + 1, false );
+         }
+
+         expect_coalesced( set );
+      }
+
+      for( uint32_t address = 0; address < expected.size(); address++ )
+      {
+         ASSERT_EQ( expected[address], set.contains( address ) ) << seed << " " << address;
+      }
+   }
+}
+
+TEST(Coalescing_IP_Range_Set, test_erase_at_ends_of_address_space) {
+   std::vector<IP_Range> ranges = { IP_Range( 0, 0 ) };
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+
+   set.erase( IP_Range::from_start_and_end_addresses( 0, 0 ) );
+   set.erase( IP_Range::from_start_and_end_addresses( 0xffffff00, 0xffffffff ) );
+   EXPECT_EQ( std::vector<std::string>( { "0.0.0.1-255.255.254.255" } ), range_strings( set ) );
+
+   set.erase( IP_Range::from_start_and_end_addresses( 0x7fffffff, 0x80000000 ) );
+   EXPECT_EQ( std::vector<std::string>( { "0.0.0.1-127.255.255.254", "128.0.0.1-255.255.254.255" } ), range_strings( set ) );
+
+   set.erase( IP_Range::from_start_and_end_addresses( 0x12345678, 0x12345678 ) );
+   set.insert( IP_Range::from_start_and_end_addresses( 0x12345678, 0x12345678 ) );
+   EXPECT_EQ( std::vector<std::string>( { "0.0.0.1-127.255.255.254", "128.0.0.1-255.255.254.255" } ), range_strings( set ) );
+}
+
+static std::string generate_workload( const Workload_Options & options )
+{
+   FILE * file = tmpfile();
+   {
+      Range_Writer writer( fileno( file ) );
+      Workload_Generator( options ).write( writer );
+      writer.flush();
+   }
+   rewind( file );
+
+   std::string text;
+   char buffer[4096];
+   for( std::size_t length; (length = fread( buffer, 1, sizeof(buffer), file )) > 0; )
+   {
+      text.append( buffer, length );
+   }
+   fclose( file );
+
+   return text;
+}
+
+TEST(Workload_Generator, test_same_options_give_same_output) {
+   Workload_Options options;
+   options.count = 2000;
+
+   const std::string text = generate_workload( options );
+   EXPECT_EQ( text, generate_workload( options ) );
+   EXPECT_EQ( 2000, std::count( text.begin(), text.end(), '\n' ) );
+
+   options.seed = 2;
+   EXPECT_NE( text, generate_workload( options ) );
+}
+
+TEST(Workload_Generator, test_output_uses_every_syntax_and_parses) {
+   Workload_Options options;
+   options.count = 20000;
+   options.noncontiguous_ratio = 0.1;
+
+   const std::string text = generate_workload( options );
+
+   std::vector<IP_Range> ranges;
+   ASSERT_NO_THROW( parse_ranges( text, ranges ) );
+   ASSERT_EQ( 20000u, ranges.size() );
+
+   std::size_t address_count = 0, prefix_length_count = 0, netmask_count = 0, dash_count = 0;
+   std::istringstream strm( text );
+   for( std::string token; strm >> token; )
+   {
+      if( token.find( '-' ) != std::string::npos ) dash_count++;
+      else if( token.find( '/' ) == std::string::npos ) address_count++;
+      else if( token.find( '.', token.find( '/' ) ) != std::string::npos ) netmask_count++;
+      else prefix_length_count++;
+   }
+
+   EXPECT_GT( address_count, 0u );
+   EXPECT_GT( prefix_length_count, 0u );
+   EXPECT_GT( netmask_count, 0u );
+   EXPECT_GT( dash_count, 0u );
+
+   std::size_t noncontiguous_count = std::count_if( ranges.begin(), ranges.end(), []( const IP_Range & range ) {
+      return !range.has_contiguous_subnet_mask();
+   } );
+   EXPECT_NEAR( 2000.0, noncontiguous_count, 300.0 );
+}
+
+TEST(Workload_Generator, test_overlap_and_adjacency_coalesce) {
+   Workload_Options options;
+   options.count = 20000;
+   options.noncontiguous_ratio = 0;
+   options.overlap_ratio = 0;
+   options.adjacency_ratio = 0;
+
+   std::vector<IP_Range> ranges;
+   parse_ranges( generate_workload( options ), ranges );
+   sort_and_coalesce( ranges );
+   const std::size_t scattered_count = ranges.size();
+
+   options.overlap_ratio = 0.5;
+   options.adjacency_ratio = 0.3;
+
+   ranges.clear();
+   parse_ranges( generate_workload( options ), ranges );
+   sort_and_coalesce( ranges );
+
+   EXPECT_GT( scattered_count, 19000u );
+   EXPECT_LT( ranges.size(), scattered_count / 2 );
+}
+
+TEST(Workload_Generator, test_sorted_orders) {
+   Workload_Options options;
+   options.count = 5000;
+   options.noncontiguous_ratio = 0;
+
+   for( auto order : { Workload_Options::Order::sorted, Workload_Options::Order::reverse_sorted } )
+   {
+      options.order = order;
+
+      std::vector<IP_Range> ranges;
+      parse_ranges( generate_workload( options ), ranges );
+
+      if( order == Workload_Options::Order::reverse_sorted )
+      {
+         std::reverse( ranges.begin(), ranges.end() );
+      }
+      EXPECT_TRUE( std::is_sorted( ranges.begin(), ranges.end() ) );
+   }
+}
+
+TEST(Workload_Generator, test_table_lines) {
+   Workload_Options options;
+   options.count = 1000;
+   options.is_table = true;
+   options.max_ranges_per_line = 20;
+
+   const std::string text = generate_workload( options );
+   EXPECT_EQ( 1000, std::count( text.begin(), text.end(), '\n' ) );
+   EXPECT_EQ( 0u, text.find( "row0:" ) );
+
+   Table_Line_Processor processor;
+   std::string output;
+   ASSERT_NO_THROW( processor.process_lines( text, output ) );
+   EXPECT_EQ( 1000, std::count( output.begin(), output.end(), '\n' ) );
+}
+
+TEST(Workload_Generator, test_invalid_options_throw) {
+   Workload_Options options;
+   options.overlap_ratio = 0.8;
+   options.adjacency_ratio = 0.3;
+   EXPECT_THROW( Workload_Generator generator( options ), std::invalid_argument );
+
+   options = Workload_Options();
+   options.netmask_ratio = 1.5;
+   EXPECT_THROW( Workload_Generator generator( options ), std::invalid_argument );
+
+   options = Workload_Options();
+   options.prefix_length_weights = { { 24, 0 } };
+   EXPECT_THROW( Workload_Generator generator( options ), std::invalid_argument );
+
+   options.prefix_length_weights = { { 33, 1 } };
+   EXPECT_THROW( Workload_Generator generator( options ), std::invalid_argument );
+}
+
+TEST(Run_Statistics, test_coalescing_set_counts_inserts_and_merges) {
+   std::vector<IP_Range> ranges;
+   for( const char * str : { "1.0.0.0/24", "1.0.1.0/24", "1.0.0.5", "2.0.0.0", "2.0.0.0" } )
+   {
+      IP_Range range;
+      range.from_string( str );
+      ranges.push_back( range );
+   }
+
+   Coalescing_IP_Range_Set set = Coalescing_IP_Range_Set::build( std::move(ranges) );
+   EXPECT_EQ( 5u, set.get_statistics().ranges_inserted );
+   EXPECT_EQ( 3u, set.get_statistics().merges );
+
+   // Bridging the gap between two stored ranges merges both into it.
+   set.insert( IP_Range::from_start_and_end_addresses( 0x01000200, 0x01FFFFFF ) );
+   EXPECT_EQ( 6u, set.get_statistics().ranges_inserted );
+   EXPECT_EQ( 5u, set.get_statistics().merges );
+   EXPECT_EQ( 1, set.size() );
+
+   set.insert( IP_Range::from_start_and_end_addresses( 0x03000000, 0x03000000 ) );
+   EXPECT_EQ( 7u, set.get_statistics().ranges_inserted );
+   EXPECT_EQ( 5u, set.get_statistics().merges );
+
+   std::vector<IP_Range> more;
+   for( uint32_t address = 0x04000000; address < 0x04000010; address++ )
+   {
+      more.push_back( IP_Range::from_start_and_end_addresses( address, address ) );
+   }
+   set.insert( more.begin(), more.end() );
+   EXPECT_EQ( 23u, set.get_statistics().ranges_inserted );
+   EXPECT_EQ( 20u, set.get_statistics().merges );
+   EXPECT_EQ( 3, set.size() );
+}
+
+TEST(Run_Statistics, test_range_reader_counts_tokens_and_failures) {
+   char path[] = "/tmp/ip_coalesce_range_reader_XXXXXX";
+   int fd = mkstemp( path );
+   ASSERT_LE( 0, fd );
+   const std::string text = "1.2.3.4 ::1\n10.0.0.0/8 bogus 5.6.7.8\n";
+   ASSERT_EQ( static_cast<ssize_t>(text.size()), write( fd, text.data(), text.size() ) );
+   close( fd );
+
+   Range_Reader reader( path );
+   std::vector<IP_Range> ranges;
+   std::vector<IP6_Range> ip6_ranges;
+   EXPECT_THROW( reader.read_all( ranges, ip6_ranges ), std::runtime_error );
+   EXPECT_EQ( 3u, reader.get_statistics().tokens_parsed );
+   EXPECT_TRUE( reader.get_statistics().stopped_on_parse_failure );
+
+   unlink( path );
+}
+
+TEST(Run_Statistics, test_table_line_processor_counts) {
+   Table_Line_Processor processor;
+   std::string output;
+
+   processor.process_line( "a:1.2.3.4,1.2.3.5,10.0.0.0/8", output );
+   processor.process_line( "b:1.2.3.4/255.0.255.0", output );
+   EXPECT_THROW( processor.process_line( "c:1.2.3.4,bogus", output ), std::runtime_error );
+
+   const Run_Counters counters = processor.take_statistics();
+   EXPECT_EQ( 3u, counters.input_lines );
+   EXPECT_EQ( 6u, counters.input_tokens );
+   EXPECT_TRUE( counters.stopped_on_parse_failure );
+   EXPECT_EQ( 5u, counters.ranges_inserted );
+   EXPECT_EQ( 1u, counters.merges );
+   EXPECT_EQ( 3u, counters.output_ranges );
+   EXPECT_EQ( 2u + (1u << 24) + (1u << 16), counters.addresses_covered );
+
+   EXPECT_EQ( 0u, processor.get_statistics().input_lines );
+}
+
+TEST(Run_Statistics, test_phases_and_report) {
+   Run_Statistics disabled( false );
+   disabled.begin_phase( "read" );
+   disabled.end_phase();
+   std::ostringstream empty;
+   disabled.print( empty );
+   EXPECT_EQ( "", empty.str() );
+
+   Run_Statistics statistics( true );
+   statistics.counters().input_tokens = 10;
+   statistics.counters().count_output_range( IP6_Range::from_start_and_end_addresses( 1, 4 ) );
+   statistics.begin_phase( "read" );
+   statistics.begin_phase( "output" );
+   statistics.end_phase();
+
+   std::ostringstream report;
+   statistics.print( report );
+   EXPECT_NE( std::string::npos, report.str().find( "input tokens" ) );
+   EXPECT_NE( std::string::npos, report.str().find( "IPv6 addresses covered" ) );
+   EXPECT_NE( std::string::npos, report.str().find( "phase read " ) );
+   EXPECT_NE( std::string::npos, report.str().find( "phase output " ) );
+   EXPECT_NE( std::string::npos, report.str().find( "peak RSS" ) );
+   EXPECT_EQ( std::string::npos, report.str().find( "input lines" ) );
+   EXPECT_LT( 0u, peak_resident_set_bytes() );
+}